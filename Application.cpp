@@ -1,5 +1,10 @@
+#include <algorithm>
 #include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <stdexcept>
+#include <string>
+#include <thread>
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_vulkan.h>
@@ -9,7 +14,9 @@
 #pragma comment(lib, "SDL2main.lib")
 #endif
 
+#include "Benchmark.h"
 #include "Math.h"
+#include "Profiler.h"
 #include "Scene.h"
 #include "RenderEngine.h"
 #include "InterfaceScene.h"
@@ -17,53 +24,147 @@
 #include "FontScene.h"
 #include "ModelScene.h"
 #include "SpriteScene.h"
+#include "StatisticsOverlay.h"
 
 class Application : RenderApplication {
 public:
     Application(int window_width, int window_height) : window_width_(window_width), window_height_(window_height) {}
 
+    void ParseArguments(int argc, char* argv[]) {
+        for (int index = 1; index < argc; index++) {
+            if (strcmp(argv[index], "--frames-in-flight") == 0 && index + 1 < argc) {
+                frames_in_flight_ = static_cast<uint32_t>(strtoul(argv[++index], nullptr, 10));
+            } else if (strcmp(argv[index], "--tick-rate") == 0 && index + 1 < argc) {
+                uint32_t tick_rate = static_cast<uint32_t>(strtoul(argv[++index], nullptr, 10));
+                if (tick_rate == 0) {
+                    throw std::runtime_error("tick rate must be above zero");
+                }
+                update_step_ = 1000000 / tick_rate;
+            } else if (strcmp(argv[index], "--max-catch-up") == 0 && index + 1 < argc) {
+                max_catch_up_updates_ = std::max(static_cast<uint32_t>(strtoul(argv[++index], nullptr, 10)), 1u);
+            } else if (strcmp(argv[index], "--present-mode") == 0 && index + 1 < argc) {
+                present_mode_ = ParsePresentMode(argv[++index]);
+            } else if (strcmp(argv[index], "--fps-limit") == 0 && index + 1 < argc) {
+                uint32_t fps_limit = static_cast<uint32_t>(strtoul(argv[++index], nullptr, 10));
+                frame_limit_ = fps_limit > 0 ? std::chrono::microseconds{1000000 / fps_limit} : std::chrono::microseconds{0};
+            } else if (strcmp(argv[index], "--low-latency") == 0) {
+                low_latency_ = true;
+            } else if (strcmp(argv[index], "--headless") == 0) {
+                headless_ = true;
+            } else if (strcmp(argv[index], "--frames") == 0 && index + 1 < argc) {
+                scene_frames_ = static_cast<uint32_t>(strtoul(argv[++index], nullptr, 10));
+            } else if (strcmp(argv[index], "--capture") == 0 && index + 1 < argc) {
+                capture_prefix_ = argv[++index];
+                capture_on_start_ = true;
+            } else if (strcmp(argv[index], "--benchmark") == 0 && index + 1 < argc) {
+                benchmark_file_ = argv[++index];
+                benchmark_ = true;
+            } else if (strcmp(argv[index], "--seed") == 0 && index + 1 < argc) {
+                seed_ = static_cast<uint32_t>(strtoul(argv[++index], nullptr, 10));
+            } else if (strcmp(argv[index], "--trace") == 0 && index + 1 < argc) {
+                trace_file_ = argv[++index];
+                trace_on_start_ = true;
+            } else if (strcmp(argv[index], "--statistics") == 0) {
+                statistics_on_start_ = true;
+            } else if (strcmp(argv[index], "--capture-format") == 0 && index + 1 < argc) {
+                index++;
+                if (strcmp(argv[index], "png") == 0) {
+                    capture_format_ = FrameCapture::Format::png;
+                } else if (strcmp(argv[index], "raw") == 0) {
+                    capture_format_ = FrameCapture::Format::raw;
+                } else {
+                    throw std::runtime_error(std::string{"unknown capture format "} + argv[index]);
+                }
+            } else {
+                throw std::runtime_error(std::string{"unknown argument "} + argv[index]);
+            }
+        }
+    }
+
     void Startup() {
-        if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+        PROFILE_THREAD("Main");
+        if (trace_on_start_) {
+            Profiler::Get().Start();
+        }
+
+        if (SDL_Init(headless_ ? 0 : SDL_INIT_VIDEO) < 0) {
             throw std::runtime_error(SDL_GetError());
         }
 
-        window_ = SDL_CreateWindow("Vulkan Testing", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, window_width_, window_height_, SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_MAXIMIZED | SDL_WINDOW_VULKAN);
+        if (headless_) {
+            render_engine_.SetHeadless(window_width_, window_height_);
+        } else {
+            window_ = SDL_CreateWindow("Vulkan Testing", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, window_width_, window_height_, SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_MAXIMIZED | SDL_WINDOW_VULKAN);
 
-        if (window_ == nullptr) {
-            throw std::runtime_error(SDL_GetError());
+            if (window_ == nullptr) {
+                throw std::runtime_error(SDL_GetError());
+            }
         }
 
         scenes_.push_back(new InterfaceScene{render_engine_, window_});
         scenes_.push_back(new CubeScene{render_engine_});
-        scenes_.push_back(new FontScene{render_engine_});
+        scenes_.push_back(new FontScene{render_engine_, seed_});
         scenes_.push_back(new ModelScene{render_engine_});
         scenes_.push_back(new SpriteScene{render_engine_});
 
+        render_engine_.SetFramesInFlight(frames_in_flight_);
+        render_engine_.SetPresentMode(present_mode_);
         render_engine_.Initialize(this);
 
+        if (capture_on_start_) {
+            render_engine_.StartCapture(capture_prefix_, capture_format_);
+        }
+
+        if (statistics_on_start_) {
+            ToggleStatistics();
+        }
+
         scene_ = scenes_[scene_index_];
         scene_->OnEntry();
     }
 
     void Run() {
+        if (benchmark_) {
+            RunBenchmark();
+            return;
+        }
+
+        if (headless_) {
+            RunHeadless();
+            return;
+        }
+
         long long frame_time = 0;
 
         auto previous_time = std::chrono::high_resolution_clock::now();
 
         while (!window_closed_) {
+            LimitFrameRate();
+
+            if (low_latency_ && !window_minimized_) {
+                render_engine_.WaitForPreviousFrame();
+            }
+
             ProcessInput();
 
             auto current_time = std::chrono::high_resolution_clock::now();
             frame_time += std::chrono::duration_cast<std::chrono::microseconds>(current_time - previous_time).count();
             previous_time = current_time;
 
-            while (frame_time > 4000) {
-                frame_time -= 4000;
+            uint32_t updates = 0;
+            while (frame_time >= update_step_ && updates < max_catch_up_updates_) {
+                frame_time -= update_step_;
                 Update();
+                updates++;
+            }
+
+            // After a hitch the simulation falls behind instead of running ever more updates per frame.
+            if (frame_time >= update_step_) {
+                frame_time %= update_step_;
             }
 
             if (!window_minimized_) {
-                Render();
+                Render(static_cast<float>(frame_time) / update_step_);
             }
         }
     }
@@ -73,8 +174,21 @@ public:
             scene->OnExit();
             scene->OnQuit();
         }
+        if (statistics_registered_) {
+            render_engine_.SetOverlay(nullptr);
+            statistics_overlay_.Unregister();
+        }
+        if (render_engine_.IsCapturing()) {
+            StopCapture();
+        }
         render_engine_.Destroy();
-        SDL_DestroyWindow(window_);
+        if (Profiler::Get().IsRecording()) {
+            Profiler::Get().Stop();
+            Profiler::Get().WriteChromeTrace(trace_file_);
+        }
+        if (window_ != nullptr) {
+            SDL_DestroyWindow(window_);
+        }
         SDL_Quit();
     }
 
@@ -85,6 +199,25 @@ private:
     SDL_Window* window_ = nullptr;
     int window_width_;
     int window_height_;
+    uint32_t frames_in_flight_ = 2;
+    long long update_step_ = 4000;
+    uint32_t max_catch_up_updates_ = 8;
+    VkPresentModeKHR present_mode_ = VK_PRESENT_MODE_FIFO_KHR;
+    std::chrono::microseconds frame_limit_{0};
+    std::chrono::high_resolution_clock::time_point next_frame_time_{};
+    bool low_latency_ = false;
+    bool headless_ = false;
+    uint32_t scene_frames_ = 300;
+    bool benchmark_ = false;
+    std::string benchmark_file_{};
+    uint32_t benchmark_warmup_frames_ = 10;
+    uint32_t seed_ = 1;
+    std::string capture_prefix_ = "capture_";
+    FrameCapture::Format capture_format_ = FrameCapture::Format::png;
+    bool capture_on_start_ = false;
+    std::string trace_file_ = "trace.json";
+    bool trace_on_start_ = false;
+    bool statistics_on_start_ = false;
 
     bool window_minimized_ = false;
     bool window_closed_ = false;
@@ -93,8 +226,29 @@ private:
     bool mouse_capture_ = false;
 
     RenderEngine render_engine_{};
+    StatisticsOverlay statistics_overlay_{render_engine_};
+    bool statistics_registered_ = false;
+    bool show_statistics_ = false;
+
+    void ToggleStatistics() {
+        if (!statistics_registered_) {
+            statistics_overlay_.Register();
+            statistics_registered_ = true;
+        }
+
+        show_statistics_ = !show_statistics_;
+        if (show_statistics_) {
+            render_engine_.SetOverlay([this](VkCommandBuffer& command_buffer, uint32_t image_index) {
+                statistics_overlay_.Record(command_buffer, image_index);
+            });
+        } else {
+            render_engine_.SetOverlay(nullptr);
+        }
+    }
 
     void ProcessInput() {
+        PROFILE_FUNCTION();
+
         SDL_Event event;
 
         while (SDL_PollEvent(&event)) {
@@ -126,6 +280,24 @@ private:
                         SDL_GetRelativeMouseState(nullptr, nullptr);
                     }
                     break;
+                case SDL_SCANCODE_F1:
+                    ToggleStatistics();
+                    break;
+                case SDL_SCANCODE_F11:
+                    if (Profiler::Get().IsRecording()) {
+                        Profiler::Get().Stop();
+                        Profiler::Get().WriteChromeTrace(trace_file_);
+                    } else {
+                        Profiler::Get().Start();
+                    }
+                    break;
+                case SDL_SCANCODE_F12:
+                    if (render_engine_.IsCapturing()) {
+                        StopCapture();
+                    } else {
+                        render_engine_.StartCapture(capture_prefix_, capture_format_);
+                    }
+                    break;
                 case SDL_SCANCODE_TAB:
                     scene_->OnExit();
                     scene_index_ = (scene_index_ + 1) % scenes_.size();
@@ -158,15 +330,159 @@ private:
         }
     }
 
+    // Steps every scene for a fixed number of frames, one update per frame, without input.
+    void RunHeadless() {
+        for (scene_index_ = 0; scene_index_ < scenes_.size(); scene_index_++) {
+            scene_->OnExit();
+            scene_ = scenes_[scene_index_];
+            scene_->OnEntry();
+
+            for (uint32_t frame = 0; frame < scene_frames_; frame++) {
+                scene_->Update(update_step_ / 1000000.0f, key_state_, false, 0, 0);
+                scene_->Render(0.0f);
+            }
+        }
+    }
+
+    // Runs every scene for scene_frames_ frames from the same seed and scripted camera path, one update
+    // per frame, and writes CPU and GPU frame times, draw calls and memory use to benchmark_file_.
+    void RunBenchmark() {
+        Benchmark benchmark{};
+        GpuProfiler& gpu_profiler = render_engine_.GetGpuProfiler();
+        gpu_profiler.CollectFrameTimes(true);
+
+        for (scene_index_ = 0; scene_index_ < scenes_.size() && !window_closed_; scene_index_++) {
+            scene_->OnExit();
+            scene_ = scenes_[scene_index_];
+            scene_->OnEntry();
+
+            // Renders without updating so the scene starts measuring from the same state however long
+            // its background loads take.
+            for (uint32_t frame = 0; (frame < benchmark_warmup_frames_ || !scene_->IsReady()) && !window_closed_; frame++) {
+                PollBenchmarkEvents();
+                scene_->Render(0.0f);
+            }
+
+            benchmark.BeginScene(scene_->GetName());
+            uint64_t first_gpu_frame = gpu_profiler.GetFrameNumber();
+
+            Benchmark::Input input{};
+            for (uint32_t frame = 0; frame < scene_frames_ && !window_closed_; frame++) {
+                PollBenchmarkEvents();
+                Benchmark::GetInput(frame, input);
+
+                auto start_time = std::chrono::high_resolution_clock::now();
+                scene_->Update(update_step_ / 1000000.0f, input.key_state, true, input.mouse_x, input.mouse_y);
+                scene_->Render(0.0f);
+                auto end_time = std::chrono::high_resolution_clock::now();
+
+                // Waiting on the GPU or the swapchain is not CPU work, so it is left out.
+                float cpu_ms = std::chrono::duration<float, std::milli>(end_time - start_time).count() - render_engine_.GetFrameWaitMs();
+                benchmark.AddFrame(std::max(cpu_ms, 0.0f), render_engine_.GetDrawCalls());
+            }
+
+            // Timestamps are read once a frame slot comes around again, so render until every measured
+            // frame has been resolved.
+            uint64_t end_gpu_frame = gpu_profiler.GetFrameNumber();
+            for (uint32_t frame = 0; frame < render_engine_.GetFramesInFlight(); frame++) {
+                scene_->Render(0.0f);
+            }
+            for (auto& frame_time : gpu_profiler.TakeFrameTimes()) {
+                if (frame_time.frame >= first_gpu_frame && frame_time.frame < end_gpu_frame) {
+                    benchmark.AddGpuFrame(frame_time.ms);
+                }
+            }
+
+            benchmark.EndScene(render_engine_.GetMemoryStatistics());
+        }
+
+        gpu_profiler.CollectFrameTimes(false);
+
+        Benchmark::Settings settings{};
+        settings.device_name = render_engine_.GetDeviceName();
+        settings.headless = headless_;
+        settings.width = render_engine_.swapchain_extent_.width;
+        settings.height = render_engine_.swapchain_extent_.height;
+        settings.frames = scene_frames_;
+        settings.frames_in_flight = render_engine_.GetFramesInFlight();
+        settings.seed = seed_;
+        benchmark.Write(benchmark_file_, settings);
+    }
+
+    // Frames without a free readback buffer or that failed to write are lost, so say how many.
+    void StopCapture() {
+        render_engine_.StopCapture();
+        uint32_t dropped = render_engine_.GetCapturesDropped();
+        if (dropped > 0) {
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "frame capture dropped %u frames", dropped);
+        }
+    }
+
+    // Keeps the window responsive during a benchmark without letting input reach the scenes.
+    void PollBenchmarkEvents() {
+        if (headless_) {
+            return;
+        }
+
+        SDL_Event event;
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_QUIT) {
+                window_closed_ = true;
+            }
+        }
+    }
+
+    static VkPresentModeKHR ParsePresentMode(const char* name) {
+        if (strcmp(name, "fifo") == 0) {
+            return VK_PRESENT_MODE_FIFO_KHR;
+        } else if (strcmp(name, "fifo-relaxed") == 0) {
+            return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+        } else if (strcmp(name, "mailbox") == 0) {
+            return VK_PRESENT_MODE_MAILBOX_KHR;
+        } else if (strcmp(name, "immediate") == 0) {
+            return VK_PRESENT_MODE_IMMEDIATE_KHR;
+        }
+        throw std::runtime_error(std::string{"unknown present mode "} + name);
+    }
+
+    // Sleeps most of the remaining frame time and spins the rest, since sleeps overshoot by up to a
+    // scheduler tick.
+    void LimitFrameRate() {
+        if (frame_limit_.count() == 0) {
+            return;
+        }
+
+        const auto spin_margin = std::chrono::microseconds{2000};
+        auto now = std::chrono::high_resolution_clock::now();
+
+        if (next_frame_time_ > now + spin_margin) {
+            std::this_thread::sleep_for(next_frame_time_ - now - spin_margin);
+        }
+        while (std::chrono::high_resolution_clock::now() < next_frame_time_) {
+            std::this_thread::yield();
+        }
+
+        // Restart the schedule after a long frame rather than rendering a burst to catch up.
+        now = std::chrono::high_resolution_clock::now();
+        if (now - next_frame_time_ > frame_limit_) {
+            next_frame_time_ = now;
+        }
+        next_frame_time_ += frame_limit_;
+    }
+
     void Update() {
+        PROFILE_FUNCTION();
+
         int mouse_x;
         int mouse_y;
         SDL_GetRelativeMouseState(&mouse_x, &mouse_y);
-        scene_->Update(key_state_, mouse_capture_, mouse_x, mouse_y);
+        scene_->Update(update_step_ / 1000000.0f, key_state_, mouse_capture_, mouse_x, mouse_y);
     }
 
-    void Render() {
-        scene_->Render();
+    void Render(float alpha) {
+        PROFILE_FUNCTION();
+
+        scene_->Render(alpha);
     }
 
     void GetRequiredExtensions(std::vector<const char*>& required_extensions) {
@@ -191,6 +507,7 @@ int main(int argc, char* argv[]) {
     Application app(800, 600);
 
     try {
+        app.ParseArguments(argc, argv);
         app.Startup();
         app.Run();
         app.Shutdown();
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <SDL2/SDL.h>
+
+#include "MemoryAllocator.h"
+
+// Collects per-frame results of scripted scene runs and writes them as JSON.
+class Benchmark {
+public:
+    struct Settings {
+        std::string device_name{};
+        bool headless{};
+        uint32_t width{};
+        uint32_t height{};
+        uint32_t frames{};
+        uint32_t frames_in_flight{};
+        uint32_t seed{};
+    };
+
+    struct Input {
+        std::array<bool, SDL_NUM_SCANCODES> key_state{};
+        int mouse_x{};
+        int mouse_y{};
+    };
+
+    // The scripted camera path, repeated when a run is longer than the script.
+    static void GetInput(uint32_t frame, Input& input) {
+        struct Step {
+            uint32_t frames;
+            SDL_Scancode key;
+            int mouse_x;
+            int mouse_y;
+        };
+
+        static const std::array<Step, 6> path = {{
+            {60, SDL_SCANCODE_W, 0, 0},
+            {45, SDL_SCANCODE_UNKNOWN, 4, 0},
+            {60, SDL_SCANCODE_A, 0, 0},
+            {45, SDL_SCANCODE_UNKNOWN, -4, 1},
+            {60, SDL_SCANCODE_S, 0, 0},
+            {30, SDL_SCANCODE_UNKNOWN, 0, -1},
+        }};
+
+        uint32_t path_frames = 0;
+        for (auto& step : path) {
+            path_frames += step.frames;
+        }
+
+        frame %= path_frames;
+        for (auto& step : path) {
+            if (frame < step.frames) {
+                input.key_state.fill(false);
+                input.key_state[step.key] = step.key != SDL_SCANCODE_UNKNOWN;
+                input.mouse_x = step.mouse_x;
+                input.mouse_y = step.mouse_y;
+                return;
+            }
+            frame -= step.frames;
+        }
+    }
+
+    void BeginScene(const std::string& name) {
+        scenes_.push_back(SceneResult{});
+        scenes_.back().name = name;
+    }
+
+    void AddFrame(float cpu_ms, uint32_t draw_calls) {
+        scenes_.back().cpu_ms.push_back(cpu_ms);
+        scenes_.back().draw_calls.push_back(static_cast<float>(draw_calls));
+    }
+
+    void AddGpuFrame(float gpu_ms) {
+        scenes_.back().gpu_ms.push_back(gpu_ms);
+    }
+
+    void EndScene(const MemoryAllocator::Statistics& memory) {
+        scenes_.back().memory = memory;
+    }
+
+    void Write(const std::string& file_name, const Settings& settings) {
+        std::ofstream file(file_name, std::ios::trunc);
+
+        if (!file.is_open()) {
+            throw std::runtime_error(std::string{"failed to open file "}+file_name);
+        }
+
+        file << "{\n";
+        file << "  \"device\": \"" << Escape(settings.device_name) << "\",\n";
+        file << "  \"mode\": \"" << (settings.headless ? "headless" : "windowed") << "\",\n";
+        file << "  \"width\": " << settings.width << ",\n";
+        file << "  \"height\": " << settings.height << ",\n";
+        file << "  \"frames\": " << settings.frames << ",\n";
+        file << "  \"frames_in_flight\": " << settings.frames_in_flight << ",\n";
+        file << "  \"seed\": " << settings.seed << ",\n";
+        file << "  \"scenes\": [";
+
+        for (size_t index = 0; index < scenes_.size(); index++) {
+            SceneResult& scene = scenes_[index];
+            file << (index == 0 ? "\n" : ",\n");
+            file << "    {\n";
+            file << "      \"name\": \"" << Escape(scene.name) << "\",\n";
+            file << "      \"cpu_ms\": " << Summarize(scene.cpu_ms) << ",\n";
+            file << "      \"gpu_ms\": " << Summarize(scene.gpu_ms) << ",\n";
+            file << "      \"draw_calls\": " << Summarize(scene.draw_calls) << ",\n";
+            file << "      \"memory\": {\"bytes_used\": " << scene.memory.bytes_used << ", \"bytes_reserved\": " << scene.memory.bytes_reserved <<
+                ", \"allocation_count\": " << scene.memory.allocation_count << ", \"block_count\": " << scene.memory.block_count << "}\n";
+            file << "    }";
+        }
+        file << "\n  ]\n}\n";
+
+        file.close();
+    }
+
+private:
+    struct SceneResult {
+        std::string name{};
+        std::vector<float> cpu_ms{};
+        std::vector<float> gpu_ms{};
+        std::vector<float> draw_calls{};
+        MemoryAllocator::Statistics memory{};
+    };
+
+    std::vector<SceneResult> scenes_{};
+
+    // Nearest-rank percentiles, so every reported value is one that was measured.
+    static std::string Summarize(std::vector<float> samples) {
+        if (samples.empty()) {
+            return "null";
+        }
+
+        std::sort(samples.begin(), samples.end());
+        auto percentile = [&samples](double fraction) {
+            size_t rank = static_cast<size_t>(std::ceil(fraction * samples.size()));
+            return samples[std::max<size_t>(rank, 1) - 1];
+        };
+
+        double sum = 0.0;
+        for (float sample : samples) {
+            sum += sample;
+        }
+
+        char summary[256];
+        snprintf(summary, sizeof(summary), "{\"count\": %zu, \"min\": %.4f, \"average\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f}",
+            samples.size(), samples.front(), sum / samples.size(), percentile(0.5), percentile(0.9), percentile(0.99), samples.back());
+        return summary;
+    }
+
+    static std::string Escape(const std::string& text) {
+        std::string escaped{};
+        for (char character : text) {
+            if (character == '"' || character == '\\') {
+                escaped += '\\';
+            }
+            escaped += character;
+        }
+        return escaped;
+    }
+};
@@ -17,7 +17,11 @@ public:
 
     Camera(RenderEngine& render_engine) : render_engine_(render_engine) {}
 
-    void Update(std::array<bool, SDL_NUM_SCANCODES>& key_state, bool mouse_capture, int mouse_x, int mouse_y) {
+    void Update(float delta_time, std::array<bool, SDL_NUM_SCANCODES>& key_state, bool mouse_capture, int mouse_x, int mouse_y) {
+        previous_position_ = camera_position_;
+        previous_forward_ = camera_forward_;
+        previous_up_ = camera_up_;
+
         if (mouse_capture) {
             camera_yaw_ = std::fmod(camera_yaw_ - 0.05f * mouse_x, 360.0f);
             camera_pitch_ = std::fmod(camera_pitch_ + 0.05f * mouse_y, 360.0f);
@@ -31,7 +35,7 @@ public:
             camera_up_ = glm::vec4(0.0f, -1.0f, 0.0f, 1.0f) * rotation;
         }
 
-        const float speed = 0.03f;
+        const float speed = 7.5f * delta_time;
 
         if (key_state[SDL_SCANCODE_W]) {
             camera_position_ += speed * camera_forward_;
@@ -48,8 +52,15 @@ public:
         if (key_state[SDL_SCANCODE_D]) {
             camera_position_ -= speed * camera_right_;
         }
+    }
+
+    // Builds camera_ between the previous and the latest Update.
+    void Interpolate(float alpha) {
+        glm::vec3 position = glm::mix(previous_position_, camera_position_, alpha);
+        glm::vec3 forward = glm::normalize(glm::mix(previous_forward_, camera_forward_, alpha));
+        glm::vec3 up = glm::normalize(glm::mix(previous_up_, camera_up_, alpha));
 
-        camera_.view_matrix = glm::lookAt(camera_position_, camera_position_ + camera_forward_, camera_up_);
+        camera_.view_matrix = glm::lookAt(position, position + forward, up);
         camera_.projection_matrix = glm::perspective(glm::radians(45.0f), render_engine_.swapchain_extent_.width / (float)render_engine_.swapchain_extent_.height, 0.1f, 100.0f);
     }
 
@@ -59,6 +70,9 @@ private:
     glm::vec3 camera_forward_{0.0f, 0.0f, 1.0f};
     glm::vec3 camera_right_{1.0f, 0.0f, 0.0f};
     glm::vec3 camera_up_{0.0f, -1.0f, 0.0f};
+    glm::vec3 previous_position_{camera_position_};
+    glm::vec3 previous_forward_{camera_forward_};
+    glm::vec3 previous_up_{camera_up_};
     float camera_yaw_ = 0.0;
     float camera_pitch_ = 0.0;
 };
\ No newline at end of file
@@ -12,6 +12,10 @@ class CubeScene : public Scene {
 public:
     CubeScene(RenderEngine& render_engine) : render_engine_(render_engine) {}
 
+    const char* GetName() {
+        return "Cube";
+    }
+
     void OnQuit() {
         if (startup_) {
             vkDeviceWaitIdle(render_engine_.device_);
@@ -39,42 +43,54 @@ public:
     void OnExit() {
     }
 
-    void Update(std::array<bool, SDL_NUM_SCANCODES>& key_state, bool mouse_capture, int mouse_x, int mouse_y) {
-        camera_.Update(key_state, mouse_capture, mouse_x, mouse_y);
-        
-        static float total_time;
-        total_time += 4.0f / 1000.0f;
-
-        float offset_1 = std::sin(total_time);
-        float offset_2 = std::cos(total_time);
-
-        color_model_.model_matrix = glm::mat4(1.0f);
-        color_model_.model_matrix = glm::translate(color_model_.model_matrix, glm::vec3(-1.0f, 0.5f, offset_1 + 1.0f));
-        color_model_.model_matrix = glm::rotate(color_model_.model_matrix, total_time * glm::radians(60.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        color_model_.model_matrix = glm::rotate(color_model_.model_matrix, total_time * glm::radians(30.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        color_model_.model_matrix = glm::rotate(color_model_.model_matrix, total_time * glm::radians(10.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        color_model_.model_matrix = glm::scale(color_model_.model_matrix, glm::vec3(1.5f, 1.5f, 1.5f));
+    void Update(float delta_time, std::array<bool, SDL_NUM_SCANCODES>& key_state, bool mouse_capture, int mouse_x, int mouse_y) {
+        camera_.Update(delta_time, key_state, mouse_capture, mouse_x, mouse_y);
 
-        texture_model_.model_matrix = glm::mat4(1.0f);
-        texture_model_.model_matrix = glm::translate(texture_model_.model_matrix, glm::vec3(1.0f, 0.5f, offset_2 + 1.0f));
-        texture_model_.model_matrix = glm::rotate(texture_model_.model_matrix, total_time * glm::radians(60.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        texture_model_.model_matrix = glm::rotate(texture_model_.model_matrix, total_time * glm::radians(30.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        texture_model_.model_matrix = glm::rotate(texture_model_.model_matrix, total_time * glm::radians(10.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        texture_model_.model_matrix = glm::scale(texture_model_.model_matrix, glm::vec3(1.5f, 1.5f, 1.5f));
+        previous_time_ = time_;
+        time_ += delta_time;
     }
 
     bool EventHandler(const SDL_Event* event) {
         return false;
     }
 
-    void Render() {
+    bool IsReady() {
+        return true;
+    }
+
+    void Render(float alpha) {
         uint32_t image_index;
 
         if (!render_engine_.AcquireNextImage(image_index)) {
             return;
         }
 
-        VkCommandBuffer& command_buffer = render_engine_.command_buffers_[image_index];
+        camera_.Interpolate(alpha);
+
+        float time = glm::mix(previous_time_, time_, alpha);
+
+        float offset_1 = std::sin(time);
+        float offset_2 = std::cos(time);
+
+        color_model_.model_matrix = glm::mat4(1.0f);
+        color_model_.model_matrix = glm::translate(color_model_.model_matrix, glm::vec3(-1.0f, 0.5f, offset_1 + 1.0f));
+        color_model_.model_matrix = glm::rotate(color_model_.model_matrix, time * glm::radians(60.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        color_model_.model_matrix = glm::rotate(color_model_.model_matrix, time * glm::radians(30.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        color_model_.model_matrix = glm::rotate(color_model_.model_matrix, time * glm::radians(10.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+        color_model_.model_matrix = glm::scale(color_model_.model_matrix, glm::vec3(1.5f, 1.5f, 1.5f));
+
+        texture_model_.model_matrix = glm::mat4(1.0f);
+        texture_model_.model_matrix = glm::translate(texture_model_.model_matrix, glm::vec3(1.0f, 0.5f, offset_2 + 1.0f));
+        texture_model_.model_matrix = glm::rotate(texture_model_.model_matrix, time * glm::radians(60.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        texture_model_.model_matrix = glm::rotate(texture_model_.model_matrix, time * glm::radians(30.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        texture_model_.model_matrix = glm::rotate(texture_model_.model_matrix, time * glm::radians(10.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+        texture_model_.model_matrix = glm::scale(texture_model_.model_matrix, glm::vec3(1.5f, 1.5f, 1.5f));
+
+        render_engine_.UpdateUniformBuffer(camera_uniform_buffer_, &camera_);
+        render_engine_.UpdateUniformBuffer(color_uniform_buffer_, &color_model_);
+        render_engine_.UpdateUniformBuffer(texture_uniform_buffer_, &texture_model_);
+
+        VkCommandBuffer& command_buffer = render_engine_.GetCommandBuffer();
 
         VkCommandBufferBeginInfo begin_info = {};
         begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -97,28 +113,29 @@ public:
         render_pass_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
         render_pass_info.pClearValues = clear_values.data();
 
-        vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
-
-        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, color_graphics_pipeline_->graphics_pipeline);
-        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, color_graphics_pipeline_->pipeline_layout, 0, 1, &color_descriptor_set_->descriptor_sets[image_index], 0, nullptr);
-        render_engine_.DrawPrimitive(command_buffer, color_primitive_);
+        std::vector<VkCommandBuffer> secondary_command_buffers = render_engine_.RecordSecondaryCommandBuffers(render_pass_, image_index, {0, 1}, [&](uint32_t index, VkCommandBuffer& secondary_command_buffer) {
+            uint32_t zone = render_engine_.GetGpuProfiler().BeginZone(secondary_command_buffer, index == 0 ? "Color cube" : "Texture cube");
+            std::shared_ptr<RenderEngine::GraphicsPipeline>& graphics_pipeline = index == 0 ? color_graphics_pipeline_ : texture_graphics_pipeline_;
+            vkCmdBindPipeline(secondary_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline->graphics_pipeline);
+            render_engine_.BindDescriptorSet(secondary_command_buffer, graphics_pipeline, image_index);
+            render_engine_.DrawPrimitive(secondary_command_buffer, index == 0 ? color_primitive_ : texture_primitive_);
+            render_engine_.GetGpuProfiler().EndZone(secondary_command_buffer, zone);
+        });
 
-        vkCmdNextSubpass(command_buffer, VK_SUBPASS_CONTENTS_INLINE);
+        uint32_t zone = render_engine_.GetGpuProfiler().BeginZone(command_buffer, "Cube pass");
+        vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        vkCmdExecuteCommands(command_buffer, 1, &secondary_command_buffers[0]);
 
-        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, texture_graphics_pipeline_->graphics_pipeline);
-        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, texture_graphics_pipeline_->pipeline_layout, 0, 1, &texture_descriptor_set_->descriptor_sets[image_index], 0, nullptr);
-        render_engine_.DrawPrimitive(command_buffer, texture_primitive_);
+        vkCmdNextSubpass(command_buffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        vkCmdExecuteCommands(command_buffer, 1, &secondary_command_buffers[1]);
 
         vkCmdEndRenderPass(command_buffer);
+        render_engine_.GetGpuProfiler().EndZone(command_buffer, zone);
 
         if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
             throw std::runtime_error("failed to record command buffer");
         }
 
-        render_engine_.UpdateUniformBuffer(camera_uniform_buffer_, image_index, &camera_);
-        render_engine_.UpdateUniformBuffer(color_uniform_buffer_, image_index, &color_model_);
-        render_engine_.UpdateUniformBuffer(texture_uniform_buffer_, image_index, &texture_model_);
-
         render_engine_.SubmitDrawCommands(image_index);
 
         render_engine_.PresentImage(image_index);
@@ -146,6 +163,9 @@ private:
         glm::mat4 model_matrix;
     };
 
+    float previous_time_ = 0.0f;
+    float time_ = 0.0f;
+
     ModelMatrix color_model_{};
     ModelMatrix texture_model_{};
 
@@ -174,7 +194,6 @@ private:
                 0,
                 true,
                 false,
-                false,
                 false
             );
         }
@@ -193,10 +212,9 @@ private:
                 Vertex_Texture::getBindingDescription(),
                 Vertex_Texture::getAttributeDescriptions(),
                 texture_descriptor_set_,
-                0,
+                1,
                 true,
                 false,
-                false,
                 false
             );
         }
@@ -217,6 +235,7 @@ private:
 
             Geometry_Color geometry_color{};
             geometry_color.AddFaces(vertices, faces, colors);
+            geometry_color.Weld();
             render_engine_.CreateIndexedPrimitive<Vertex_Color, uint32_t>(geometry_color.vertices, geometry_color.indices, color_primitive_);
 
             std::vector<glm::vec2> texture_coordinates = {
@@ -228,6 +247,7 @@ private:
 
             Geometry_Texture geometry_texture{};
             geometry_texture.AddFaces(vertices, faces, texture_coordinates);
+            geometry_texture.Weld();
             render_engine_.CreateIndexedPrimitive<Vertex_Texture, uint32_t>(geometry_texture.vertices, geometry_texture.indices, texture_primitive_);
         }
     }
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+struct DescriptorAllocation {
+    VkDescriptorSet set{};
+    uint32_t pool{};
+};
+
+class DescriptorAllocator {
+public:
+    void Initialize(VkDevice device, bool free_individual_sets, uint32_t initial_sets_per_pool = 64) {
+        device_ = device;
+        free_individual_sets_ = free_individual_sets;
+        sets_per_pool_ = initial_sets_per_pool;
+    }
+
+    void Destroy() {
+        for (auto& pool : pools_) {
+            vkDestroyDescriptorPool(device_, pool, nullptr);
+        }
+        pools_.clear();
+        current_pool_ = 0;
+    }
+
+    DescriptorAllocation Allocate(VkDescriptorSetLayout layout) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        DescriptorAllocation allocation{};
+
+        VkDescriptorSetAllocateInfo allocate_info = {};
+        allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocate_info.descriptorSetCount = 1;
+        allocate_info.pSetLayouts = &layout;
+
+        // Pools filled earlier are retried first; freed sets leave holes in them.
+        size_t attempts = pools_.size() - current_pool_ + 1;
+        for (size_t attempt = 0; attempt < attempts; attempt++) {
+            if (current_pool_ == pools_.size()) {
+                CreatePool();
+            }
+
+            allocate_info.descriptorPool = pools_[current_pool_];
+
+            VkResult result = vkAllocateDescriptorSets(device_, &allocate_info, &allocation.set);
+            if (result == VK_SUCCESS) {
+                allocation.pool = current_pool_;
+                return allocation;
+            }
+            if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) {
+                break;
+            }
+
+            current_pool_++;
+        }
+
+        throw std::runtime_error("failed to allocate descriptor set");
+    }
+
+    void Free(DescriptorAllocation& allocation) {
+        if (allocation.set == VK_NULL_HANDLE) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        vkFreeDescriptorSets(device_, pools_[allocation.pool], 1, &allocation.set);
+        current_pool_ = std::min(current_pool_, allocation.pool);
+        allocation = {};
+    }
+
+    void Reset() {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        for (auto& pool : pools_) {
+            vkResetDescriptorPool(device_, pool, 0);
+        }
+        current_pool_ = 0;
+    }
+
+private:
+    static const uint32_t max_sets_per_pool_ = 4096;
+
+    VkDevice device_{};
+    bool free_individual_sets_{};
+    uint32_t sets_per_pool_{};
+    uint32_t current_pool_{};
+    std::vector<VkDescriptorPool> pools_{};
+    std::mutex mutex_{};
+
+    void CreatePool() {
+        // Sized for the layouts the engine builds: a few dynamic uniforms and samplers per set.
+        std::array<VkDescriptorPoolSize, 2> pool_sizes = {};
+        pool_sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        pool_sizes[0].descriptorCount = sets_per_pool_ * 2;
+        pool_sizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        pool_sizes[1].descriptorCount = sets_per_pool_ * 2;
+
+        VkDescriptorPoolCreateInfo pool_info = {};
+        pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        pool_info.flags = free_individual_sets_ ? VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT : 0;
+        pool_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
+        pool_info.pPoolSizes = pool_sizes.data();
+        pool_info.maxSets = sets_per_pool_;
+
+        VkDescriptorPool pool{};
+        if (vkCreateDescriptorPool(device_, &pool_info, nullptr, &pool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create descriptor pool");
+        }
+        pools_.push_back(pool);
+
+        sets_per_pool_ = std::min(sets_per_pool_ * 2, max_sets_per_pool_);
+    }
+};
+
+class DescriptorLayoutCache {
+public:
+    void Initialize(VkDevice device) {
+        device_ = device;
+    }
+
+    void Destroy() {
+        for (auto& layout : layouts_) {
+            vkDestroyDescriptorSetLayout(device_, layout.second, nullptr);
+        }
+        layouts_.clear();
+    }
+
+    VkDescriptorSetLayout GetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        std::vector<BindingKey> key{};
+        for (auto& binding : bindings) {
+            key.push_back({binding.binding, binding.descriptorType, binding.descriptorCount, binding.stageFlags});
+        }
+        std::sort(key.begin(), key.end());
+
+        auto cached = layouts_.find(key);
+        if (cached != layouts_.end()) {
+            return cached->second;
+        }
+
+        VkDescriptorSetLayoutCreateInfo layout_info = {};
+        layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layout_info.bindingCount = static_cast<uint32_t>(bindings.size());
+        layout_info.pBindings = bindings.data();
+
+        VkDescriptorSetLayout layout{};
+        if (vkCreateDescriptorSetLayout(device_, &layout_info, nullptr, &layout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create descriptor set layout");
+        }
+        layouts_[key] = layout;
+
+        return layout;
+    }
+
+private:
+    struct BindingKey {
+        uint32_t binding;
+        VkDescriptorType type;
+        uint32_t count;
+        VkShaderStageFlags stages;
+
+        bool operator<(const BindingKey& other) const {
+            return std::tie(binding, type, count, stages) < std::tie(other.binding, other.type, other.count, other.stages);
+        }
+    };
+
+    VkDevice device_{};
+    std::map<std::vector<BindingKey>, VkDescriptorSetLayout> layouts_{};
+    std::mutex mutex_{};
+};
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <random>
+
 #include "Math.h"
 #include "Scene.h"
 #include "RenderEngine.h"
@@ -9,7 +11,11 @@
 
 class FontScene : public Scene {
 public:
-    FontScene(RenderEngine& render_engine) : render_engine_(render_engine) {}
+    FontScene(RenderEngine& render_engine, uint32_t seed) : render_engine_(render_engine), random_(seed) {}
+
+    const char* GetName() {
+        return "Font";
+    }
 
     void OnQuit() {
         if (startup_) {
@@ -28,14 +34,18 @@ public:
     void OnExit() {
     }
 
-    void Update(std::array<bool, SDL_NUM_SCANCODES>& key_state, bool mouse_capture, int mouse_x, int mouse_y) {
+    void Update(float delta_time, std::array<bool, SDL_NUM_SCANCODES>& key_state, bool mouse_capture, int mouse_x, int mouse_y) {
     }
 
     bool EventHandler(const SDL_Event* event) {
         return false;
     }
 
-    void Render() {
+    bool IsReady() {
+        return true;
+    }
+
+    void Render(float alpha) {
         uint32_t image_index;
 
         if (!render_engine_.AcquireNextImage(image_index)) {
@@ -48,21 +58,21 @@ public:
         uint32_t window_height = render_engine_.swapchain_extent_.height;
 
         for (int i = 0; i < WORD_COUNT; i++) {
-            const char* word = words_[rand() % words_.size()];
+            const char* word = words_[random_() % words_.size()];
 
             uint32_t width;
             uint32_t height;
             text_.GetSize(word, width, height);
 
             glm::vec3 color = {
-                (rand() % 256) / 255.0,
-                (rand() % 256) / 255.0,
-                (rand() % 256) / 255.0
+                (random_() % 256) / 255.0,
+                (random_() % 256) / 255.0,
+                (random_() % 256) / 255.0
             };
 
             glm::vec2 position = {
-                rand() % (window_width - width),
-                rand() % (window_height - height)
+                random_() % (window_width - width),
+                random_() % (window_height - height)
             };
 
             text_.Draw(color, position, word);
@@ -70,7 +80,7 @@ public:
 
         text_.DrawEnd();
 
-        VkCommandBuffer& command_buffer = render_engine_.command_buffers_[image_index];
+        VkCommandBuffer& command_buffer = render_engine_.GetCommandBuffer();
 
         VkCommandBufferBeginInfo begin_info = {};
         begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -93,11 +103,15 @@ public:
         render_pass_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
         render_pass_info.pClearValues = clear_values.data();
 
+        uint32_t zone = render_engine_.GetGpuProfiler().BeginZone(command_buffer, "Font pass");
         vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
 
+        render_engine_.SetViewportScissor(command_buffer);
+
         text_.Render(command_buffer, image_index);
 
         vkCmdEndRenderPass(command_buffer);
+        render_engine_.GetGpuProfiler().EndZone(command_buffer, zone);
 
         if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
             throw std::runtime_error("failed to record command buffer");
@@ -113,6 +127,7 @@ private:
     bool startup_ = false;
     std::shared_ptr<RenderEngine::RenderPass> render_pass_{};
     Text text_{render_engine_};
+    std::mt19937 random_;
 
     std::vector<const char*> words_ = {
         "acceptable",
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Profiler.h"
+#include "Utility.h"
+
+// Writes captured frames to disk on a background thread. Pixels stay owned by the caller until release
+// is called with the frame's buffer index.
+class FrameCapture {
+public:
+    enum class Format { png, raw };
+
+    struct Frame {
+        uint32_t buffer{};
+        uint64_t number{};
+        uint32_t width{};
+        uint32_t height{};
+        bool bgra{};
+        const unsigned char* pixels{};
+    };
+
+    void Start(const std::string& prefix, Format format, std::function<void(uint32_t)> release) {
+        prefix_ = prefix;
+        format_ = format;
+        release_ = release;
+        stop_ = false;
+        failed_frames_ = 0;
+        encoder_thread_ = std::thread([this]() { EncoderLoop(); });
+    }
+
+    // Writes every queued frame before returning.
+    void Stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        condition_.notify_all();
+        encoder_thread_.join();
+    }
+
+    void Push(const Frame& frame) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            frames_.push_back(frame);
+        }
+        condition_.notify_all();
+    }
+
+    uint32_t GetFailedFrames() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return failed_frames_;
+    }
+
+    // Blocks until every queued frame has been written and released.
+    void Flush() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_.wait(lock, [this]() { return frames_.empty() && !encoding_; });
+    }
+
+private:
+    std::string prefix_{};
+    Format format_{};
+    std::function<void(uint32_t)> release_{};
+    std::thread encoder_thread_{};
+    std::mutex mutex_{};
+    std::condition_variable condition_{};
+    std::deque<Frame> frames_{};
+    bool encoding_{};
+    bool stop_{};
+    uint32_t failed_frames_{};
+
+    void EncoderLoop() {
+        PROFILE_THREAD("Frame capture");
+
+        std::vector<unsigned char> rgba{};
+
+        while (true) {
+            Frame frame{};
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                condition_.wait(lock, [this]() { return stop_ || !frames_.empty(); });
+                if (frames_.empty()) {
+                    return;
+                }
+                frame = frames_.front();
+                frames_.pop_front();
+                encoding_ = true;
+            }
+
+            PROFILE_SCOPE("Encode frame");
+
+            // Copy out of the readback buffer first so it can be reused while the file is encoded.
+            size_t size = static_cast<size_t>(frame.width) * frame.height * 4;
+            rgba.assign(frame.pixels, frame.pixels + size);
+            release_(frame.buffer);
+
+            if (frame.bgra) {
+                for (size_t i = 0; i < size; i += 4) {
+                    std::swap(rgba[i], rgba[i + 2]);
+                }
+            }
+
+            char number[16];
+            snprintf(number, sizeof(number), "%06llu", static_cast<unsigned long long>(frame.number));
+
+            bool written = true;
+            try {
+                if (format_ == Format::png) {
+                    Utility::WritePng(prefix_ + number + ".png", frame.width, frame.height, rgba.data());
+                } else {
+                    Utility::WriteFile(prefix_ + number + ".rgba", rgba);
+                }
+            } catch (const std::runtime_error&) {
+                written = false;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                encoding_ = false;
+                failed_frames_ += written ? 0 : 1;
+            }
+            condition_.notify_all();
+        }
+    }
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+// Rolling per-frame timings. Frame is the interval between consecutive frames, CPU is the part of it not
+// spent waiting in acquire or present, and GPU is the span of the frame's timestamp zones.
+class FrameStatistics {
+public:
+    enum class Metric { frame, cpu, gpu, acquire, present };
+
+    struct Summary {
+        float p50{};
+        float p95{};
+        float p99{};
+        float max{};
+    };
+
+    static const uint32_t metric_count = 5;
+    static const uint32_t history_size = 240;
+
+    void Add(Metric metric, float ms) {
+        History& history = histories_[static_cast<uint32_t>(metric)];
+        history.samples[history.next] = ms;
+        history.next = (history.next + 1) % history_size;
+        history.count = std::min(history.count + 1, history_size);
+    }
+
+    // Samples oldest first.
+    std::vector<float> GetHistory(Metric metric) {
+        History& history = histories_[static_cast<uint32_t>(metric)];
+        std::vector<float> samples{};
+        samples.reserve(history.count);
+        for (uint32_t index = 0; index < history.count; index++) {
+            samples.push_back(history.samples[(history.next + history_size - history.count + index) % history_size]);
+        }
+        return samples;
+    }
+
+    Summary Summarize(Metric metric) {
+        std::vector<float> samples = GetHistory(metric);
+        Summary summary{};
+        if (samples.empty()) {
+            return summary;
+        }
+
+        std::sort(samples.begin(), samples.end());
+        summary.p50 = Percentile(samples, 50);
+        summary.p95 = Percentile(samples, 95);
+        summary.p99 = Percentile(samples, 99);
+        summary.max = samples.back();
+        return summary;
+    }
+
+    // A stutter is a frame that took more than twice the median frame time.
+    uint32_t CountStutters() {
+        std::vector<float> samples = GetHistory(Metric::frame);
+        if (samples.empty()) {
+            return 0;
+        }
+
+        float threshold = 2.0f * Summarize(Metric::frame).p50;
+        return static_cast<uint32_t>(std::count_if(samples.begin(), samples.end(), [threshold](float sample) { return sample > threshold; }));
+    }
+
+    uint32_t GetCount(Metric metric) {
+        return histories_[static_cast<uint32_t>(metric)].count;
+    }
+
+private:
+    struct History {
+        std::array<float, history_size> samples{};
+        uint32_t count{};
+        uint32_t next{};
+    };
+
+    std::array<History, metric_count> histories_{};
+
+    // Nearest rank of sorted samples.
+    static float Percentile(const std::vector<float>& samples, uint32_t percent) {
+        size_t rank = (samples.size() * percent + 99) / 100;
+        return samples[std::max<size_t>(rank, 1) - 1];
+    }
+};
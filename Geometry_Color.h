@@ -9,6 +9,8 @@
 
 #include <vulkan/vulkan.h>
 
+#include "VertexWelder.h"
+
 struct Vertex_Color {
     glm::vec3 pos;
     glm::vec3 color;
@@ -40,6 +42,11 @@ public:
         }
     }
 
+    // Merges the vertices faces share, optionally those within epsilon of each other.
+    void Weld(float epsilon = 0.0f) {
+        VertexWelder<Vertex_Color>::Weld(vertices, indices, epsilon);
+    }
+
     void AddFace(std::vector<glm::vec3>& vertices, std::vector<uint32_t>& face, glm::vec3& color) {
         switch (face.size()) {
         case 3:
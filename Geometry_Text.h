@@ -9,6 +9,8 @@
 
 #include <vulkan/vulkan.h>
 
+#include "VertexWelder.h"
+
 struct Vertex_Text {
     glm::vec2 pos;
     glm::vec2 texCoord;
@@ -38,6 +40,11 @@ public:
         }
     }
 
+    // Merges the vertices faces share, optionally those within epsilon of each other.
+    void Weld(float epsilon = 0.0f) {
+        VertexWelder<Vertex_Text>::Weld(vertices, indices, epsilon);
+    }
+
     void AddFace(std::vector<glm::vec2>& vertices, std::vector<uint32_t>& face, std::vector<glm::vec2>& texture_coords) {
         switch (face.size()) {
         case 3:
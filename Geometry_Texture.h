@@ -5,10 +5,11 @@
 #include <vector>
 
 #include <glm/glm.hpp>
-#include <glm/gtx/hash.hpp>
 
 #include <vulkan/vulkan.h>
 
+#include "VertexWelder.h"
+
 struct Vertex_Texture {
     glm::vec3 pos;
     glm::vec2 texCoord;
@@ -31,12 +32,6 @@ struct Vertex_Texture {
     }
 };
 
-struct Vertex_Texture_Hash {
-    size_t operator()(Vertex_Texture const& vertex) const {
-        return std::hash<glm::vec3>()(vertex.pos) ^ std::hash<glm::vec2>()(vertex.texCoord);
-    }
-};
-
 class Geometry_Texture {
 public:
     std::vector<Vertex_Texture> vertices;
@@ -48,6 +43,11 @@ public:
         }
     }
 
+    // Merges the vertices faces share, optionally those within epsilon of each other.
+    void Weld(float epsilon = 0.0f) {
+        VertexWelder<Vertex_Texture>::Weld(vertices, indices, epsilon);
+    }
+
 private:
     void AddFace(std::vector<glm::vec3>& vertices, std::vector<uint32_t>& face, std::vector<glm::vec2>& texture_coords) {
         switch (face.size()) {
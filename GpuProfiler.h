@@ -0,0 +1,252 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+// Timestamp zones written into the command buffers of a frame slot and read back once the slot's fence
+// has signalled, so reading them never stalls.
+class GpuProfiler {
+public:
+    struct ZoneStatistics {
+        std::string name{};
+        float last_ms{};
+        float min_ms{};
+        float average_ms{};
+        float max_ms{};
+    };
+
+    struct FrameTime {
+        uint64_t frame{};
+        float ms{};
+    };
+
+    static const uint32_t no_zone = UINT32_MAX;
+
+    void Initialize(VkDevice device, float timestamp_period, uint32_t timestamp_valid_bits, uint32_t frame_count) {
+        device_ = device;
+        enabled_ = timestamp_valid_bits > 0;
+        if (!enabled_) {
+            return;
+        }
+
+        timestamp_period_ = timestamp_period;
+        timestamp_mask_ = timestamp_valid_bits >= 64 ? UINT64_MAX : (1ull << timestamp_valid_bits) - 1;
+
+        VkQueryPoolCreateInfo pool_info = {};
+        pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        pool_info.queryCount = max_zones_per_frame_ * 2;
+
+        for (uint32_t index = 0; index < frame_count; index++) {
+            frames_.push_back(std::make_unique<Frame>());
+            if (vkCreateQueryPool(device_, &pool_info, nullptr, &frames_.back()->query_pool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create timestamp query pool");
+            }
+        }
+    }
+
+    void Destroy() {
+        for (auto& frame : frames_) {
+            vkDestroyQueryPool(device_, frame->query_pool, nullptr);
+        }
+        frames_.clear();
+    }
+
+    bool IsEnabled() {
+        return enabled_;
+    }
+
+    // Safe to call from several threads recording the same frame. name must outlive the frame.
+    uint32_t BeginZone(VkCommandBuffer command_buffer, const char* name) {
+        if (!enabled_) {
+            return no_zone;
+        }
+
+        Frame& frame = *frames_[current_frame_];
+        uint32_t zone = frame.zone_count++;
+        if (zone >= max_zones_per_frame_) {
+            return no_zone;
+        }
+
+        frame.names[zone] = name;
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.query_pool, zone * 2);
+        return zone;
+    }
+
+    void EndZone(VkCommandBuffer command_buffer, uint32_t zone) {
+        if (zone == no_zone) {
+            return;
+        }
+
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frames_[current_frame_]->query_pool, zone * 2 + 1);
+    }
+
+    // Records the reset of the queries the current frame used. The command buffer must run before the
+    // frame's own command buffer. Returns false when there is nothing to reset.
+    bool RecordReset(VkCommandBuffer command_buffer) {
+        if (!enabled_) {
+            return false;
+        }
+
+        Frame& frame = *frames_[current_frame_];
+        uint32_t zone_count = std::min<uint32_t>(frame.zone_count, max_zones_per_frame_);
+        if (zone_count == 0) {
+            return false;
+        }
+
+        vkCmdResetQueryPool(command_buffer, frame.query_pool, 0, zone_count * 2);
+        frame.submitted = true;
+        frame.number = frame_number_++;
+        return true;
+    }
+
+    // Number the next frame with zones will get.
+    uint64_t GetFrameNumber() {
+        return frame_number_;
+    }
+
+    // While enabled, Resolve also keeps the span from the first zone's start to the last zone's end of
+    // every frame until TakeFrameTimes.
+    void CollectFrameTimes(bool collect) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        collect_frame_times_ = collect;
+        frame_times_.clear();
+    }
+
+    std::vector<FrameTime> TakeFrameTimes() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<FrameTime> frame_times{};
+        frame_times.swap(frame_times_);
+        return frame_times;
+    }
+
+    // Reads the results of frame_index, whose fence must have signalled, and makes it the current frame.
+    // Returns true when the slot held a frame with zones that completed.
+    bool Resolve(uint32_t frame_index) {
+        if (!enabled_) {
+            return false;
+        }
+
+        current_frame_ = frame_index;
+        Frame& frame = *frames_[frame_index];
+        uint32_t zone_count = std::min<uint32_t>(frame.zone_count, max_zones_per_frame_);
+        bool submitted = frame.submitted;
+        frame.zone_count = 0;
+        frame.submitted = false;
+
+        if (!submitted || zone_count == 0) {
+            return false;
+        }
+
+        // Each query yields its value followed by its availability.
+        std::vector<uint64_t> results(static_cast<size_t>(zone_count) * 4);
+        vkGetQueryPoolResults(device_, frame.query_pool, 0, zone_count * 2, results.size() * sizeof(uint64_t), results.data(), sizeof(uint64_t) * 2, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+        std::map<std::string, float> frame_ms{};
+        uint64_t frame_begin = UINT64_MAX;
+        uint64_t frame_end = 0;
+        for (uint32_t zone = 0; zone < zone_count; zone++) {
+            const uint64_t* begin = &results[zone * 4];
+            const uint64_t* end = &results[zone * 4 + 2];
+            if (begin[1] == 0 || end[1] == 0) {
+                continue;
+            }
+            frame_ms[frame.names[zone]] += static_cast<float>(((end[0] - begin[0]) & timestamp_mask_) * timestamp_period_ / 1000000.0);
+            frame_begin = std::min(frame_begin, begin[0]);
+            frame_end = std::max(frame_end, end[0]);
+        }
+
+        last_frame_ms_ = frame_end > frame_begin ? static_cast<float>((frame_end - frame_begin) * timestamp_period_ / 1000000.0) : 0.0f;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (collect_frame_times_ && frame_end > frame_begin) {
+            frame_times_.push_back(FrameTime{frame.number, last_frame_ms_});
+        }
+        for (auto& zone : frame_ms) {
+            History& history = histories_[zone.first];
+            if (history.count == 0) {
+                order_.push_back(zone.first);
+            }
+            history.samples[history.next] = zone.second;
+            history.next = (history.next + 1) % history_size_;
+            history.count = std::min<uint32_t>(history.count + 1, history_size_);
+            history.last = zone.second;
+        }
+
+        return frame_end > frame_begin;
+    }
+
+    // Span from the first zone's start to the last zone's end of the frame last resolved.
+    float GetLastFrameMs() {
+        return last_frame_ms_;
+    }
+
+    // Rolling statistics over the last frames that recorded each zone, in order of first appearance.
+    std::vector<ZoneStatistics> GetStatistics() {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        std::vector<ZoneStatistics> statistics{};
+        for (auto& name : order_) {
+            History& history = histories_[name];
+
+            ZoneStatistics zone{};
+            zone.name = name;
+            zone.last_ms = history.last;
+            zone.min_ms = history.samples[0];
+            zone.max_ms = history.samples[0];
+            for (uint32_t index = 0; index < history.count; index++) {
+                zone.min_ms = std::min(zone.min_ms, history.samples[index]);
+                zone.max_ms = std::max(zone.max_ms, history.samples[index]);
+                zone.average_ms += history.samples[index];
+            }
+            zone.average_ms /= history.count;
+
+            statistics.push_back(zone);
+        }
+
+        return statistics;
+    }
+
+private:
+    static const uint32_t max_zones_per_frame_ = 256;
+    static const uint32_t history_size_ = 120;
+
+    struct Frame {
+        VkQueryPool query_pool{};
+        std::atomic<uint32_t> zone_count{};
+        std::array<const char*, max_zones_per_frame_> names{};
+        bool submitted{};
+        uint64_t number{};
+    };
+
+    struct History {
+        std::array<float, history_size_> samples{};
+        uint32_t count{};
+        uint32_t next{};
+        float last{};
+    };
+
+    VkDevice device_{};
+    bool enabled_{};
+    float timestamp_period_{};
+    uint64_t timestamp_mask_{};
+    std::vector<std::unique_ptr<Frame>> frames_{};
+    uint32_t current_frame_{};
+    uint64_t frame_number_{};
+    float last_frame_ms_{};
+
+    std::mutex mutex_{};
+    std::map<std::string, History> histories_{};
+    std::vector<std::string> order_{};
+    bool collect_frame_times_{};
+    std::vector<FrameTime> frame_times_{};
+};
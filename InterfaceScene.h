@@ -13,6 +13,10 @@ class InterfaceScene : public Scene {
 public:
     InterfaceScene(RenderEngine& render_engine, SDL_Window* window) : render_engine_(render_engine), window_(window) {}
 
+    const char* GetName() {
+        return "Interface";
+    }
+
     void OnQuit() {
         if (startup_) {
             vkDeviceWaitIdle(render_engine_.device_);
@@ -36,7 +40,7 @@ public:
     void OnExit() {
     }
 
-    void Update(std::array<bool, SDL_NUM_SCANCODES>& key_state, bool mouse_capture, int mouse_x, int mouse_y) {
+    void Update(float delta_time, std::array<bool, SDL_NUM_SCANCODES>& key_state, bool mouse_capture, int mouse_x, int mouse_y) {
         static Uint64 frequency = SDL_GetPerformanceFrequency();
         Uint64 current_time = SDL_GetPerformanceCounter();
         ImGuiIO& io = ImGui::GetIO();
@@ -52,7 +56,11 @@ public:
         return ProcessEvent(event);
     }
 
-    void Render() {
+    bool IsReady() {
+        return true;
+    }
+
+    void Render(float alpha) {
         uint32_t image_index;
 
         if (!render_engine_.AcquireNextImage(image_index)) {
@@ -90,6 +98,43 @@ public:
             ImGui::Text("counter = %d", counter);
 
             ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+
+            MemoryAllocator::Statistics memory = render_engine_.GetMemoryStatistics();
+            ImGui::Text("Memory %u blocks, %u dedicated, %u allocations", memory.block_count, memory.dedicated_count, memory.allocation_count);
+            ImGui::Text("Memory %.1f / %.1f MB used, %.1f KB wasted, %.0f%% fragmented", memory.bytes_used / (1024.0 * 1024.0), memory.bytes_reserved / (1024.0 * 1024.0), memory.bytes_wasted / 1024.0, memory.fragmentation * 100.0);
+            ImGui::End();
+        }
+
+        {
+            ImGui::Begin("GPU Profiler");
+
+            if (render_engine_.GetGpuProfiler().IsEnabled()) {
+                if (ImGui::BeginTable("zones", 5)) {
+                    ImGui::TableSetupColumn("Zone");
+                    ImGui::TableSetupColumn("Last ms");
+                    ImGui::TableSetupColumn("Min ms");
+                    ImGui::TableSetupColumn("Avg ms");
+                    ImGui::TableSetupColumn("Max ms");
+                    ImGui::TableHeadersRow();
+                    for (auto& zone : render_engine_.GetGpuProfiler().GetStatistics()) {
+                        ImGui::TableNextRow();
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%s", zone.name.c_str());
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%.3f", zone.last_ms);
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%.3f", zone.min_ms);
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%.3f", zone.average_ms);
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%.3f", zone.max_ms);
+                    }
+                    ImGui::EndTable();
+                }
+            } else {
+                ImGui::Text("Timestamps are not supported on the graphics queue");
+            }
+
             ImGui::End();
         }
 
@@ -120,11 +165,8 @@ public:
         }
 
         if (vertex_size != 0 && index_size != 0) {
-            ImDrawVert* vtx_dst = NULL;
-            ImDrawIdx* idx_dst = NULL;
-
-            vkMapMemory(render_engine_.device_, vertex_buffer_.memory, 0, vertex_size, 0, (void**)(&vtx_dst));
-            vkMapMemory(render_engine_.device_, index_buffer_.memory, 0, index_size, 0, (void**)(&idx_dst));
+            ImDrawVert* vtx_dst = static_cast<ImDrawVert*>(vertex_buffer_.memory.mapped);
+            ImDrawIdx* idx_dst = static_cast<ImDrawIdx*>(index_buffer_.memory.mapped);
 
             for (int n = 0; n < draw_data->CmdListsCount; n++) {
                 const ImDrawList* cmd_list = draw_data->CmdLists[n];
@@ -133,21 +175,9 @@ public:
                 vtx_dst += cmd_list->VtxBuffer.Size;
                 idx_dst += cmd_list->IdxBuffer.Size;
             }
-
-            VkMappedMemoryRange range[2] = {};
-            range[0].sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-            range[0].memory = vertex_buffer_.memory;
-            range[0].size = VK_WHOLE_SIZE;
-            range[1].sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-            range[1].memory = index_buffer_.memory;
-            range[1].size = VK_WHOLE_SIZE;
-            vkFlushMappedMemoryRanges(render_engine_.device_, 2, range);
-
-            vkUnmapMemory(render_engine_.device_, vertex_buffer_.memory);
-            vkUnmapMemory(render_engine_.device_, index_buffer_.memory);
         }
 
-        VkCommandBuffer& command_buffer = render_engine_.command_buffers_[image_index];
+        VkCommandBuffer& command_buffer = render_engine_.GetCommandBuffer();
 
         VkCommandBufferBeginInfo begin_info = {};
         begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -173,11 +203,12 @@ public:
         render_pass_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
         render_pass_info.pClearValues = clear_values.data();
 
+        uint32_t zone = render_engine_.GetGpuProfiler().BeginZone(command_buffer, "Interface pass");
         vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
 
         vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline_->graphics_pipeline);
 
-        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline_->pipeline_layout, 0, 1, &descriptor_set_->descriptor_sets[image_index], 0, nullptr);
+        render_engine_.BindDescriptorSet(command_buffer, graphics_pipeline_, image_index);
 
         if (vertex_size != 0 && index_size != 0) {
             VkBuffer vertex_buffers[1] = {vertex_buffer_.buffer};
@@ -239,7 +270,7 @@ public:
                     scissor.extent.height = (uint32_t)(clip_rect.w - clip_rect.y);
                     vkCmdSetScissor(command_buffer, 0, 1, &scissor);
 
-                    vkCmdDrawIndexed(command_buffer, pcmd->ElemCount, 1, pcmd->IdxOffset + global_idx_offset, pcmd->VtxOffset + global_vtx_offset, 0);
+                    render_engine_.DrawIndexed(command_buffer, pcmd->ElemCount, pcmd->IdxOffset + global_idx_offset, pcmd->VtxOffset + global_vtx_offset);
                 }
             }
 
@@ -248,6 +279,7 @@ public:
         }
 
         vkCmdEndRenderPass(command_buffer);
+        render_engine_.GetGpuProfiler().EndZone(command_buffer, zone);
 
         if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
             throw std::runtime_error("failed to record command buffer");
@@ -324,7 +356,6 @@ private:
                 0,
                 false,
                 true,
-                true,
                 true
             );
         }
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <string>
+#include <vector>
+
+#include "Profiler.h"
+
+class JobSystem {
+public:
+    class Counter;
+
+    struct Job {
+        std::function<void()> function{};
+        Counter* signal{};
+    };
+
+    // Number of jobs still pending against it. A job can be held back until a counter reaches zero.
+    class Counter {
+    public:
+        bool IsDone() {
+            return pending_ == 0;
+        }
+
+    private:
+        friend class JobSystem;
+
+        std::atomic<uint32_t> pending_{};
+        std::mutex mutex_{};
+        std::vector<Job> continuations_{};
+        std::exception_ptr exception_{};
+    };
+
+    void Initialize(uint32_t thread_count) {
+        stop_ = false;
+        for (uint32_t queue = 0; queue < thread_count + 1; queue++) {
+            queues_.push_back(std::make_unique<Queue>());
+        }
+        for (uint32_t worker = 0; worker < thread_count; worker++) {
+            threads_.emplace_back([this, worker]() { WorkerLoop(worker); });
+        }
+    }
+
+    // Jobs still queued are dropped, so wait on their counters first.
+    void Destroy() {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            stop_ = true;
+        }
+        sleep_condition_.notify_all();
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+        threads_.clear();
+        queues_.clear();
+    }
+
+    uint32_t GetWorkerCount() {
+        return static_cast<uint32_t>(queues_.size());
+    }
+
+    // Worker threads get [0, GetWorkerCount() - 1); every other thread shares the last index.
+    uint32_t GetWorkerIndex() {
+        uint32_t worker = CurrentWorker();
+        return worker == UINT32_MAX ? static_cast<uint32_t>(threads_.size()) : worker;
+    }
+
+    // Queues function on the calling worker's deque, or from any other thread on the worker deques in
+    // turn. signal stays above zero until it has run, and it is not started before dependency reaches zero.
+    void Run(std::function<void()> function, Counter* signal = nullptr, Counter* dependency = nullptr) {
+        if (signal != nullptr) {
+            signal->pending_++;
+        }
+
+        Job job{std::move(function), signal};
+
+        if (dependency != nullptr) {
+            std::lock_guard<std::mutex> lock(dependency->mutex_);
+            if (dependency->pending_ != 0) {
+                dependency->continuations_.push_back(std::move(job));
+                return;
+            }
+        }
+
+        Push(std::move(job));
+    }
+
+    // Runs queued jobs on the calling thread until counter reaches zero. The first exception thrown by a
+    // job signalling counter is rethrown here. Worker threads run any job meanwhile, so they may block for
+    // as long as the longest job, such as a model load. Other threads, the main thread among them, only
+    // run jobs signalling counter, so a frame never picks up unrelated long jobs.
+    void Wait(Counter& counter) {
+        uint32_t worker = GetWorkerIndex();
+        bool run_any = CurrentWorker() != UINT32_MAX || threads_.empty();
+
+        while (counter.pending_ != 0) {
+            Job job{};
+            if (run_any ? Pop(worker, job) : PopSignalling(counter, job)) {
+                Execute(job);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+
+        std::exception_ptr exception{};
+        {
+            std::lock_guard<std::mutex> lock(counter.mutex_);
+            std::swap(exception, counter.exception_);
+        }
+        if (exception != nullptr) {
+            std::rethrow_exception(exception);
+        }
+    }
+
+    // Calls function(index, worker) for every index in [0, count) in jobs of batch_size indices and waits
+    // for all of them.
+    void ParallelFor(uint32_t count, uint32_t batch_size, const std::function<void(uint32_t, uint32_t)>& function) {
+        Counter counter{};
+        batch_size = std::max(batch_size, 1u);
+
+        for (uint32_t begin = 0; begin < count; begin += batch_size) {
+            uint32_t end = std::min(begin + batch_size, count);
+            Run([this, &function, begin, end]() {
+                uint32_t worker = GetWorkerIndex();
+                for (uint32_t index = begin; index < end; index++) {
+                    function(index, worker);
+                }
+            }, &counter);
+        }
+
+        Wait(counter);
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex{};
+        std::deque<Job> jobs{};
+    };
+
+    std::vector<std::thread> threads_{};
+    std::vector<std::unique_ptr<Queue>> queues_{};
+    std::atomic<uint32_t> queued_jobs_{};
+    std::atomic<uint32_t> next_queue_{};
+    std::mutex sleep_mutex_{};
+    std::condition_variable sleep_condition_{};
+    bool stop_{};
+
+    static uint32_t& CurrentWorker() {
+        static thread_local uint32_t worker = UINT32_MAX;
+        return worker;
+    }
+
+    void Push(Job job) {
+        // Jobs from other threads go to the workers, keeping them off the shared deque those threads
+        // would otherwise run them from. Without workers the shared deque is all there is.
+        uint32_t index = GetWorkerIndex();
+        if (CurrentWorker() == UINT32_MAX && !threads_.empty()) {
+            index = next_queue_++ % static_cast<uint32_t>(threads_.size());
+        }
+
+        Queue& queue = *queues_[index];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.jobs.push_back(std::move(job));
+        }
+        queued_jobs_++;
+
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+        }
+        sleep_condition_.notify_one();
+    }
+
+    // The owner takes its newest job; thieves take the oldest job of the other deques.
+    bool Pop(uint32_t worker, Job& job) {
+        uint32_t queue_count = static_cast<uint32_t>(queues_.size());
+
+        for (uint32_t offset = 0; offset < queue_count; offset++) {
+            Queue& queue = *queues_[(worker + offset) % queue_count];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.jobs.empty()) {
+                continue;
+            }
+
+            if (offset == 0) {
+                job = std::move(queue.jobs.back());
+                queue.jobs.pop_back();
+            } else {
+                job = std::move(queue.jobs.front());
+                queue.jobs.pop_front();
+            }
+            queued_jobs_--;
+            return true;
+        }
+
+        return false;
+    }
+
+    // Takes the oldest job signalling counter from any deque.
+    bool PopSignalling(Counter& counter, Job& job) {
+        for (auto& queue : queues_) {
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            auto found = std::find_if(queue->jobs.begin(), queue->jobs.end(), [&counter](const Job& queued) { return queued.signal == &counter; });
+            if (found == queue->jobs.end()) {
+                continue;
+            }
+
+            job = std::move(*found);
+            queue->jobs.erase(found);
+            queued_jobs_--;
+            return true;
+        }
+
+        return false;
+    }
+
+    void Execute(Job& job) {
+        std::exception_ptr exception{};
+        try {
+            job.function();
+        } catch (...) {
+            exception = std::current_exception();
+        }
+
+        Counter* signal = job.signal;
+        if (signal == nullptr) {
+            return;
+        }
+
+        // The counter may be destroyed as soon as a waiter sees zero and takes the lock, so nothing
+        // touches it after the lock is released.
+        std::vector<Job> continuations{};
+        {
+            std::lock_guard<std::mutex> lock(signal->mutex_);
+            if (exception != nullptr && signal->exception_ == nullptr) {
+                signal->exception_ = exception;
+            }
+            if (--signal->pending_ == 0) {
+                continuations.swap(signal->continuations_);
+            }
+        }
+
+        for (auto& continuation : continuations) {
+            Push(std::move(continuation));
+        }
+    }
+
+    void WorkerLoop(uint32_t worker) {
+        CurrentWorker() = worker;
+        PROFILE_THREAD(("Job worker " + std::to_string(worker)).c_str());
+
+        while (true) {
+            Job job{};
+            if (Pop(worker, job)) {
+                Execute(job);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            sleep_condition_.wait(lock, [this]() { return stop_ || queued_jobs_ > 0; });
+            if (stop_) {
+                return;
+            }
+        }
+    }
+};
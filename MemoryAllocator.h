@@ -0,0 +1,363 @@
+#pragma once
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+struct Allocation {
+    VkDeviceMemory memory{};
+    VkDeviceSize offset{};
+    VkDeviceSize size{};
+    void* mapped{};
+    uint32_t pool{};
+    uint32_t block{};
+    VkDeviceSize range_offset{};
+    VkDeviceSize range_size{};
+};
+
+class MemoryAllocator {
+public:
+    struct Statistics {
+        uint32_t block_count{};
+        uint32_t dedicated_count{};
+        uint32_t allocation_count{};
+        VkDeviceSize bytes_reserved{};
+        VkDeviceSize bytes_used{};
+        VkDeviceSize bytes_wasted{};
+        float fragmentation{};
+    };
+
+    void Initialize(VkPhysicalDevice physical_device, VkDevice device, VkDeviceSize block_size = 64 * 1024 * 1024) {
+        device_ = device;
+        block_size_ = block_size;
+        vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties_);
+
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(physical_device, &properties);
+        non_coherent_atom_size_ = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+        pools_.resize(static_cast<size_t>(memory_properties_.memoryTypeCount) * 2);
+    }
+
+    void Destroy() {
+        for (auto& pool : pools_) {
+            for (auto& block : pool.blocks) {
+                if (block.memory != VK_NULL_HANDLE) {
+                    FreeBlock(block);
+                }
+            }
+            pool.blocks.clear();
+        }
+        for (auto& block : dedicated_) {
+            if (block.memory != VK_NULL_HANDLE) {
+                FreeBlock(block);
+            }
+        }
+        dedicated_.clear();
+    }
+
+    Allocation Allocate(const VkMemoryRequirements& memory_requirements, VkMemoryPropertyFlags properties, bool linear) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        uint32_t memory_type = FindMemoryType(memory_requirements.memoryTypeBits, properties);
+
+        if (memory_requirements.size > GetBlockSize(memory_type) / 2) {
+            return AllocateDedicated(memory_requirements, memory_type);
+        }
+
+        uint32_t pool_index = memory_type * 2 + (linear ? 1 : 0);
+        Pool& pool = pools_[pool_index];
+
+        Allocation allocation{};
+        allocation.pool = pool_index;
+
+        for (uint32_t block_index = 0; block_index < pool.blocks.size(); block_index++) {
+            allocation.block = block_index;
+            if (pool.blocks[block_index].memory != VK_NULL_HANDLE && AllocateFromBlock(pool.blocks[block_index], memory_requirements, allocation)) {
+                return allocation;
+            }
+        }
+
+        Block block{};
+        AllocateBlock(memory_type, GetBlockSize(memory_type), block);
+
+        uint32_t block_index = 0;
+        while (block_index < pool.blocks.size() && pool.blocks[block_index].memory != VK_NULL_HANDLE) {
+            block_index++;
+        }
+        if (block_index == pool.blocks.size()) {
+            pool.blocks.push_back(block);
+        } else {
+            pool.blocks[block_index] = block;
+        }
+
+        allocation.block = block_index;
+        if (!AllocateFromBlock(pool.blocks[block_index], memory_requirements, allocation)) {
+            throw std::runtime_error("failed to sub-allocate device memory");
+        }
+
+        return allocation;
+    }
+
+    bool HasMemoryType(uint32_t type_filter, VkMemoryPropertyFlags properties) {
+        for (uint32_t i = 0; i < memory_properties_.memoryTypeCount; i++) {
+            if ((type_filter & (1 << i)) && (memory_properties_.memoryTypes[i].propertyFlags & properties) == properties) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Makes what the device wrote to a mapped allocation visible to the host. Coherent memory needs nothing.
+    void Invalidate(const Allocation& allocation) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        Block& block = allocation.pool == dedicated_pool_ ? dedicated_[allocation.block] : pools_[allocation.pool].blocks[allocation.block];
+        if (memory_properties_.memoryTypes[block.memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) {
+            return;
+        }
+
+        // The range has to start and end on atom boundaries, or at the end of the memory.
+        VkDeviceSize begin = allocation.offset / non_coherent_atom_size_ * non_coherent_atom_size_;
+        VkDeviceSize end = (allocation.offset + allocation.size + non_coherent_atom_size_ - 1) / non_coherent_atom_size_ * non_coherent_atom_size_;
+
+        VkMappedMemoryRange range = {};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = block.memory;
+        range.offset = begin;
+        range.size = end >= block.size ? VK_WHOLE_SIZE : end - begin;
+        vkInvalidateMappedMemoryRanges(device_, 1, &range);
+    }
+
+    void Free(Allocation& allocation) {
+        if (allocation.memory == VK_NULL_HANDLE) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (allocation.pool == dedicated_pool_) {
+            Block& block = dedicated_[allocation.block];
+            FreeBlock(block);
+            block = {};
+            allocation = {};
+            return;
+        }
+
+        Pool& pool = pools_[allocation.pool];
+        Block& block = pool.blocks[allocation.block];
+
+        Range range{allocation.range_offset, allocation.range_size};
+        auto next = std::lower_bound(block.free_ranges.begin(), block.free_ranges.end(), range, [](const Range& a, const Range& b) { return a.offset < b.offset; });
+        next = block.free_ranges.insert(next, range);
+
+        if (next + 1 != block.free_ranges.end() && next->offset + next->size == (next + 1)->offset) {
+            next->size += (next + 1)->size;
+            block.free_ranges.erase(next + 1);
+        }
+
+        if (next != block.free_ranges.begin() && (next - 1)->offset + (next - 1)->size == next->offset) {
+            (next - 1)->size += next->size;
+            block.free_ranges.erase(next);
+        }
+
+        block.bytes_used -= allocation.size;
+        block.bytes_wasted -= allocation.range_size - allocation.size;
+        block.allocation_count--;
+
+        if (block.allocation_count == 0) {
+            uint32_t empty_blocks = 0;
+            for (auto& other : pool.blocks) {
+                if (other.memory != VK_NULL_HANDLE && other.allocation_count == 0) {
+                    empty_blocks++;
+                }
+            }
+            if (empty_blocks > 1) {
+                FreeBlock(block);
+                block = {};
+            }
+        }
+
+        allocation = {};
+    }
+
+    Statistics GetStatistics() {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        Statistics statistics{};
+        VkDeviceSize bytes_free = 0;
+        VkDeviceSize largest_free = 0;
+
+        for (auto& pool : pools_) {
+            for (auto& block : pool.blocks) {
+                if (block.memory == VK_NULL_HANDLE) {
+                    continue;
+                }
+                statistics.block_count++;
+                statistics.allocation_count += block.allocation_count;
+                statistics.bytes_reserved += block.size;
+                statistics.bytes_used += block.bytes_used;
+                statistics.bytes_wasted += block.bytes_wasted;
+                for (auto& range : block.free_ranges) {
+                    bytes_free += range.size;
+                    largest_free = std::max(largest_free, range.size);
+                }
+            }
+        }
+
+        for (auto& block : dedicated_) {
+            if (block.memory == VK_NULL_HANDLE) {
+                continue;
+            }
+            statistics.dedicated_count++;
+            statistics.allocation_count++;
+            statistics.bytes_reserved += block.size;
+            statistics.bytes_used += block.bytes_used;
+            statistics.bytes_wasted += block.size - block.bytes_used;
+        }
+
+        if (bytes_free > 0) {
+            statistics.fragmentation = 1.0f - static_cast<float>(largest_free) / static_cast<float>(bytes_free);
+        }
+
+        return statistics;
+    }
+
+private:
+    struct Range {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+    };
+
+    struct Block {
+        VkDeviceMemory memory{};
+        VkDeviceSize size{};
+        uint32_t memory_type{};
+        void* mapped{};
+        std::vector<Range> free_ranges{};
+        VkDeviceSize bytes_used{};
+        VkDeviceSize bytes_wasted{};
+        uint32_t allocation_count{};
+    };
+
+    struct Pool {
+        std::vector<Block> blocks{};
+    };
+
+    static const uint32_t dedicated_pool_ = UINT32_MAX;
+
+    VkDevice device_{};
+    VkDeviceSize block_size_{};
+    VkPhysicalDeviceMemoryProperties memory_properties_{};
+    VkDeviceSize non_coherent_atom_size_{1};
+    std::vector<Pool> pools_{};
+    std::vector<Block> dedicated_{};
+    std::mutex mutex_{};
+
+    uint32_t FindMemoryType(uint32_t type_filter, VkMemoryPropertyFlags properties) {
+        for (uint32_t i = 0; i < memory_properties_.memoryTypeCount; i++) {
+            if ((type_filter & (1 << i)) && (memory_properties_.memoryTypes[i].propertyFlags & properties) == properties) {
+                return i;
+            }
+        }
+
+        throw std::runtime_error("unable to find required memory type");
+    }
+
+    VkDeviceSize GetBlockSize(uint32_t memory_type) {
+        VkDeviceSize heap_size = memory_properties_.memoryHeaps[memory_properties_.memoryTypes[memory_type].heapIndex].size;
+        return std::min(block_size_, heap_size / 8);
+    }
+
+    void AllocateBlock(uint32_t memory_type, VkDeviceSize size, Block& block) {
+        VkMemoryAllocateInfo allocate_info = {};
+        allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocate_info.allocationSize = size;
+        allocate_info.memoryTypeIndex = memory_type;
+
+        if (vkAllocateMemory(device_, &allocate_info, nullptr, &block.memory) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate device memory block");
+        }
+
+        block.size = size;
+        block.memory_type = memory_type;
+        block.free_ranges.push_back({0, size});
+
+        if (memory_properties_.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+            if (vkMapMemory(device_, block.memory, 0, VK_WHOLE_SIZE, 0, &block.mapped) != VK_SUCCESS) {
+                throw std::runtime_error("failed to map device memory block");
+            }
+        }
+    }
+
+    void FreeBlock(Block& block) {
+        if (block.mapped != nullptr) {
+            vkUnmapMemory(device_, block.memory);
+        }
+        vkFreeMemory(device_, block.memory, nullptr);
+    }
+
+    bool AllocateFromBlock(Block& block, const VkMemoryRequirements& memory_requirements, Allocation& allocation) {
+        VkDeviceSize alignment = std::max<VkDeviceSize>(memory_requirements.alignment, 1);
+
+        for (auto range = block.free_ranges.begin(); range != block.free_ranges.end(); range++) {
+            VkDeviceSize aligned_offset = (range->offset + alignment - 1) / alignment * alignment;
+            VkDeviceSize padding = aligned_offset - range->offset;
+
+            if (padding + memory_requirements.size > range->size) {
+                continue;
+            }
+
+            allocation.memory = block.memory;
+            allocation.offset = aligned_offset;
+            allocation.size = memory_requirements.size;
+            allocation.mapped = block.mapped != nullptr ? static_cast<char*>(block.mapped) + aligned_offset : nullptr;
+            allocation.range_offset = range->offset;
+            allocation.range_size = padding + memory_requirements.size;
+
+            range->offset += allocation.range_size;
+            range->size -= allocation.range_size;
+            if (range->size == 0) {
+                block.free_ranges.erase(range);
+            }
+
+            block.bytes_used += allocation.size;
+            block.bytes_wasted += padding;
+            block.allocation_count++;
+
+            return true;
+        }
+
+        return false;
+    }
+
+    Allocation AllocateDedicated(const VkMemoryRequirements& memory_requirements, uint32_t memory_type) {
+        Block block{};
+        AllocateBlock(memory_type, memory_requirements.size, block);
+        block.free_ranges.clear();
+        block.bytes_used = memory_requirements.size;
+        block.allocation_count = 1;
+
+        uint32_t block_index = 0;
+        while (block_index < dedicated_.size() && dedicated_[block_index].memory != VK_NULL_HANDLE) {
+            block_index++;
+        }
+        if (block_index == dedicated_.size()) {
+            dedicated_.push_back(block);
+        } else {
+            dedicated_[block_index] = block;
+        }
+
+        Allocation allocation{};
+        allocation.memory = block.memory;
+        allocation.offset = 0;
+        allocation.size = memory_requirements.size;
+        allocation.mapped = block.mapped;
+        allocation.pool = dedicated_pool_;
+        allocation.block = block_index;
+        allocation.range_size = memory_requirements.size;
+        return allocation;
+    }
+};
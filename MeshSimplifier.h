@@ -0,0 +1,491 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Geometry_Texture.h"
+#include "VertexWelder.h"
+
+// Simplifies indexed triangle lists by collapsing edges onto one of their vertices, so every level of
+// detail keeps using the original vertex buffer. Costs come from quadrics over position and texture
+// coordinate (Garland and Heckbert, "Simplifying Surfaces with Color and Texture using Quadric Error
+// Metrics"), and vertices on open borders or texture seams only slide along them.
+namespace MeshSimplifier {
+    // Symmetric 5x5 quadric over x, y, z, u and v, weighted by triangle area.
+    struct Quadric {
+        double a[15];
+        double b[5];
+        double c;
+        double weight;
+    };
+
+    static const size_t quadric_size = 5;
+
+    static size_t QuadricIndex(size_t row, size_t column) {
+        if (row > column) {
+            std::swap(row, column);
+        }
+        return row * quadric_size - row * (row + 1) / 2 + column;
+    }
+
+    static void AddQuadric(Quadric& target, const Quadric& source) {
+        for (size_t index = 0; index < 15; index++) {
+            target.a[index] += source.a[index];
+        }
+        for (size_t index = 0; index < quadric_size; index++) {
+            target.b[index] += source.b[index];
+        }
+        target.c += source.c;
+        target.weight += source.weight;
+    }
+
+    static double EvaluateQuadric(const Quadric& quadric, const double* point) {
+        double error = quadric.c;
+        for (size_t row = 0; row < quadric_size; row++) {
+            error += 2.0 * quadric.b[row] * point[row];
+            for (size_t column = 0; column < quadric_size; column++) {
+                error += point[row] * quadric.a[QuadricIndex(row, column)] * point[column];
+            }
+        }
+        return std::max(error, 0.0);
+    }
+
+    // Distance to the plane through p, q and r in the five dimensional space.
+    static void AddTriangleQuadric(Quadric& quadric, const double* p, const double* q, const double* r, double weight) {
+        double e1[quadric_size];
+        double e2[quadric_size];
+        double length1 = 0.0;
+        for (size_t index = 0; index < quadric_size; index++) {
+            e1[index] = q[index] - p[index];
+            length1 += e1[index] * e1[index];
+        }
+        if (length1 <= 0.0) {
+            return;
+        }
+        length1 = std::sqrt(length1);
+
+        double projection = 0.0;
+        for (size_t index = 0; index < quadric_size; index++) {
+            e1[index] /= length1;
+            projection += (r[index] - p[index]) * e1[index];
+        }
+
+        double length2 = 0.0;
+        for (size_t index = 0; index < quadric_size; index++) {
+            e2[index] = r[index] - p[index] - projection * e1[index];
+            length2 += e2[index] * e2[index];
+        }
+        if (length2 <= 0.0) {
+            return;
+        }
+        length2 = std::sqrt(length2);
+
+        double p_e1 = 0.0;
+        double p_e2 = 0.0;
+        double p_p = 0.0;
+        for (size_t index = 0; index < quadric_size; index++) {
+            e2[index] /= length2;
+            p_e1 += p[index] * e1[index];
+            p_e2 += p[index] * e2[index];
+            p_p += p[index] * p[index];
+        }
+
+        for (size_t row = 0; row < quadric_size; row++) {
+            for (size_t column = row; column < quadric_size; column++) {
+                double identity = row == column ? 1.0 : 0.0;
+                quadric.a[QuadricIndex(row, column)] += weight * (identity - e1[row] * e1[column] - e2[row] * e2[column]);
+            }
+            quadric.b[row] += weight * (p_e1 * e1[row] + p_e2 * e2[row] - p[row]);
+        }
+        quadric.c += weight * (p_p - p_e1 * p_e1 - p_e2 * p_e2);
+        quadric.weight += weight;
+    }
+
+    // Distance to a plane in position only, used to keep open borders in place.
+    static void AddPlaneQuadric(Quadric& quadric, const glm::vec3& normal, const glm::vec3& point, double weight) {
+        double n[3] = {normal.x, normal.y, normal.z};
+        double d = -(n[0] * point.x + n[1] * point.y + n[2] * point.z);
+        for (size_t row = 0; row < 3; row++) {
+            for (size_t column = row; column < 3; column++) {
+                quadric.a[QuadricIndex(row, column)] += weight * n[row] * n[column];
+            }
+            quadric.b[row] += weight * d * n[row];
+        }
+        quadric.c += weight * d * d;
+        quadric.weight += weight;
+    }
+
+    enum class Kind : uint8_t { manifold, border, seam, locked };
+
+    // Reduces indices to about target_index_count, or as close as collapses allow without flipping
+    // triangles. Returns the largest error accepted as a distance in model units. attribute_weight
+    // scales how much a texture coordinate difference across the whole mesh weighs against a
+    // positional one of the mesh's size.
+    static float Simplify(const std::vector<Vertex_Texture>& vertices, std::vector<uint32_t>& indices, size_t target_index_count, float attribute_weight = 1.0f) {
+        const uint32_t none = UINT32_MAX;
+        const double border_weight = 2.0;
+        size_t vertex_count = vertices.size();
+
+        // Vertices sharing a position are wedges of it; remap points every wedge at the first one.
+        std::vector<bool> used(vertex_count, false);
+        for (uint32_t index : indices) {
+            used[index] = true;
+        }
+
+        std::vector<uint32_t> remap(vertex_count, none);
+        std::vector<uint32_t> next_wedge(vertex_count, none);
+        std::vector<uint32_t> wedge_count(vertex_count, 0);
+        {
+            VertexWelder<glm::vec3> positions{0.0f, vertex_count};
+            std::vector<uint32_t> first_vertex{};
+            for (uint32_t vertex = 0; vertex < vertex_count; vertex++) {
+                if (!used[vertex]) {
+                    continue;
+                }
+
+                uint32_t position = positions.Add(vertices[vertex].pos);
+                if (position == first_vertex.size()) {
+                    first_vertex.push_back(vertex);
+                }
+                uint32_t first = first_vertex[position];
+                remap[vertex] = first;
+                wedge_count[first]++;
+
+                // Wedges of a position form a ring through next_wedge.
+                next_wedge[vertex] = first == vertex ? vertex : next_wedge[first];
+                next_wedge[first] = vertex;
+            }
+        }
+
+        // The other wedge of a position with exactly two, which is where texture seams run.
+        std::vector<uint32_t> twin(vertex_count, none);
+        for (uint32_t vertex = 0; vertex < vertex_count; vertex++) {
+            if (used[vertex] && wedge_count[remap[vertex]] == 2) {
+                twin[vertex] = next_wedge[vertex];
+            }
+        }
+
+        glm::vec3 bounds_min = vertices.empty() ? glm::vec3{0.0f} : vertices[indices.empty() ? 0 : indices[0]].pos;
+        glm::vec3 bounds_max = bounds_min;
+        for (uint32_t index : indices) {
+            bounds_min = glm::min(bounds_min, vertices[index].pos);
+            bounds_max = glm::max(bounds_max, vertices[index].pos);
+        }
+        glm::vec3 extent = bounds_max - bounds_min;
+        double attribute_scale = attribute_weight * std::max(extent.x, std::max(extent.y, extent.z));
+
+        auto get_point = [&](uint32_t vertex, double* point) {
+            point[0] = vertices[vertex].pos.x;
+            point[1] = vertices[vertex].pos.y;
+            point[2] = vertices[vertex].pos.z;
+            point[3] = vertices[vertex].texCoord.x * attribute_scale;
+            point[4] = vertices[vertex].texCoord.y * attribute_scale;
+        };
+
+        // Outgoing half-edges of each vertex and the triangle each belongs to, rebuilt every pass.
+        std::vector<uint32_t> offsets(vertex_count + 1);
+        std::vector<uint32_t> targets{};
+        std::vector<uint32_t> triangles{};
+        auto build_adjacency = [&]() {
+            std::fill(offsets.begin(), offsets.end(), 0);
+            for (uint32_t index : indices) {
+                offsets[index + 1]++;
+            }
+            for (size_t vertex = 0; vertex < vertex_count; vertex++) {
+                offsets[vertex + 1] += offsets[vertex];
+            }
+
+            targets.resize(indices.size());
+            triangles.resize(indices.size());
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t index = 0; index < indices.size(); index++) {
+                size_t next = index % 3 == 2 ? index - 2 : index + 1;
+                uint32_t slot = fill[indices[index]]++;
+                targets[slot] = indices[next];
+                triangles[slot] = static_cast<uint32_t>(index / 3);
+            }
+        };
+
+        auto has_edge = [&](uint32_t from, uint32_t to) {
+            for (uint32_t slot = offsets[from]; slot < offsets[from + 1]; slot++) {
+                if (targets[slot] == to) {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        auto has_position_edge = [&](uint32_t from, uint32_t to) {
+            uint32_t wedge = from;
+            do {
+                for (uint32_t slot = offsets[wedge]; slot < offsets[wedge + 1]; slot++) {
+                    if (remap[targets[slot]] == remap[to]) {
+                        return true;
+                    }
+                }
+                wedge = next_wedge[wedge];
+            } while (wedge != from);
+            return false;
+        };
+
+        build_adjacency();
+
+        // Open half-edges are those without an opposite one. Following them gives the next vertex along a
+        // border or seam in loop and the previous one in loop_back.
+        std::vector<uint32_t> loop(vertex_count, none);
+        std::vector<uint32_t> loop_back(vertex_count, none);
+        std::vector<uint8_t> open_out(vertex_count, 0);
+        std::vector<uint8_t> open_in(vertex_count, 0);
+        for (size_t index = 0; index < indices.size(); index++) {
+            uint32_t from = indices[index];
+            uint32_t to = indices[index % 3 == 2 ? index - 2 : index + 1];
+            if (!has_edge(to, from)) {
+                open_out[from] = static_cast<uint8_t>(std::min(open_out[from] + 1, 2));
+                open_in[to] = static_cast<uint8_t>(std::min(open_in[to] + 1, 2));
+                loop[from] = to;
+                loop_back[to] = from;
+            }
+        }
+
+        std::vector<Kind> kinds(vertex_count, Kind::locked);
+        for (uint32_t vertex = 0; vertex < vertex_count; vertex++) {
+            if (!used[vertex]) {
+                continue;
+            }
+
+            uint32_t wedges = wedge_count[remap[vertex]];
+            bool single_loop = open_out[vertex] == 1 && open_in[vertex] == 1;
+            if (wedges == 1 && open_out[vertex] == 0 && open_in[vertex] == 0) {
+                kinds[vertex] = Kind::manifold;
+            } else if (wedges == 1 && single_loop) {
+                kinds[vertex] = Kind::border;
+            } else if (wedges == 2 && single_loop && open_out[twin[vertex]] == 1 && open_in[twin[vertex]] == 1 &&
+                has_position_edge(loop[vertex], vertex) && has_position_edge(vertex, loop_back[vertex])) {
+                kinds[vertex] = Kind::seam;
+            }
+        }
+
+        std::vector<Quadric> quadrics(vertex_count, Quadric{});
+        for (size_t index = 0; index < indices.size(); index += 3) {
+            double p[quadric_size];
+            double q[quadric_size];
+            double r[quadric_size];
+            get_point(indices[index + 0], p);
+            get_point(indices[index + 1], q);
+            get_point(indices[index + 2], r);
+
+            const glm::vec3& p0 = vertices[indices[index + 0]].pos;
+            const glm::vec3& p1 = vertices[indices[index + 1]].pos;
+            const glm::vec3& p2 = vertices[indices[index + 2]].pos;
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            double area = glm::length(normal) * 0.5;
+
+            Quadric quadric{};
+            AddTriangleQuadric(quadric, p, q, r, area);
+            for (size_t corner = 0; corner < 3; corner++) {
+                AddQuadric(quadrics[indices[index + corner]], quadric);
+            }
+
+            if (area <= 0.0) {
+                continue;
+            }
+
+            // Open edges in position space are mesh borders; a plane through them at right angles to the
+            // triangle keeps them from moving inwards.
+            for (size_t corner = 0; corner < 3; corner++) {
+                uint32_t from = indices[index + corner];
+                uint32_t to = indices[index + (corner + 1) % 3];
+                if (has_position_edge(to, from)) {
+                    continue;
+                }
+
+                glm::vec3 edge = vertices[to].pos - vertices[from].pos;
+                float length = glm::length(edge);
+                if (length <= 0.0f) {
+                    continue;
+                }
+                glm::vec3 plane_normal = glm::normalize(glm::cross(edge, normal));
+
+                Quadric border{};
+                AddPlaneQuadric(border, plane_normal, vertices[from].pos, border_weight * length * length);
+                AddQuadric(quadrics[from], border);
+                AddQuadric(quadrics[to], border);
+            }
+        }
+
+        auto can_collapse = [&](uint32_t from, uint32_t to) {
+            if (remap[from] == remap[to]) {
+                return false;
+            }
+
+            switch (kinds[from]) {
+            case Kind::manifold:
+                return true;
+            case Kind::border:
+                return kinds[to] == Kind::border && (loop[from] == to || loop_back[from] == to);
+            case Kind::seam:
+                return kinds[to] == Kind::seam && (loop[from] == to || loop_back[from] == to) &&
+                    (loop[twin[from]] == twin[to] || loop_back[twin[from]] == twin[to]);
+            default:
+                return false;
+            }
+        };
+
+        auto collapse_cost = [&](uint32_t from, uint32_t to) {
+            double point[quadric_size];
+            get_point(to, point);
+            double error = EvaluateQuadric(quadrics[from], point) + EvaluateQuadric(quadrics[to], point);
+            double weight = quadrics[from].weight + quadrics[to].weight;
+
+            if (kinds[from] == Kind::seam) {
+                get_point(twin[to], point);
+                error += EvaluateQuadric(quadrics[twin[from]], point) + EvaluateQuadric(quadrics[twin[to]], point);
+                weight += quadrics[twin[from]].weight + quadrics[twin[to]].weight;
+            }
+
+            return weight > 0.0 ? error / weight : 0.0;
+        };
+
+        // Moving every wedge of from onto to must not turn any remaining triangle around, or so far that it
+        // stands on edge.
+        auto flips_triangle = [&](uint32_t from, uint32_t to) {
+            for (uint32_t wedge : {from, twin[from]}) {
+                if (wedge == none) {
+                    continue;
+                }
+                for (uint32_t slot = offsets[wedge]; slot < offsets[wedge + 1]; slot++) {
+                    uint32_t triangle = triangles[slot];
+                    glm::vec3 corners[3];
+                    glm::vec3 moved[3];
+                    bool removed = false;
+                    for (uint32_t corner = 0; corner < 3; corner++) {
+                        uint32_t vertex = indices[triangle * 3 + corner];
+                        removed |= remap[vertex] == remap[to];
+                        corners[corner] = vertices[vertex].pos;
+                        moved[corner] = remap[vertex] == remap[from] ? vertices[to].pos : corners[corner];
+                    }
+                    if (removed) {
+                        continue;
+                    }
+
+                    glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+                    glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                    if (glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after)) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        };
+
+        struct Collapse {
+            uint32_t from;
+            uint32_t to;
+            double cost;
+        };
+
+        std::vector<Collapse> collapses{};
+        std::vector<uint32_t> collapse_remap(vertex_count);
+        std::vector<bool> locked(vertex_count);
+        double max_error = 0.0;
+
+        while (indices.size() > target_index_count) {
+            collapses.clear();
+            for (size_t index = 0; index < indices.size(); index++) {
+                uint32_t from = indices[index];
+                uint32_t to = indices[index % 3 == 2 ? index - 2 : index + 1];
+
+                // Each edge is looked at once from each of its triangles; keep the cheaper direction.
+                bool forward = can_collapse(from, to);
+                bool backward = can_collapse(to, from);
+                double forward_cost = forward ? collapse_cost(from, to) : 0.0;
+                double backward_cost = backward ? collapse_cost(to, from) : 0.0;
+                if (forward && (!backward || forward_cost <= backward_cost)) {
+                    collapses.push_back({from, to, forward_cost});
+                } else if (backward) {
+                    collapses.push_back({to, from, backward_cost});
+                }
+            }
+
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+            for (uint32_t vertex = 0; vertex < vertex_count; vertex++) {
+                collapse_remap[vertex] = vertex;
+            }
+            std::fill(locked.begin(), locked.end(), false);
+
+            // A manifold collapse removes two triangles, others one.
+            size_t triangles_to_remove = (indices.size() - target_index_count) / 3;
+            size_t triangles_removed = 0;
+            size_t collapse_count = 0;
+            for (auto& collapse : collapses) {
+                if (triangles_removed >= triangles_to_remove) {
+                    break;
+                }
+                if (locked[remap[collapse.from]] || locked[remap[collapse.to]] || flips_triangle(collapse.from, collapse.to)) {
+                    continue;
+                }
+
+                collapse_remap[collapse.from] = collapse.to;
+                AddQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+                if (kinds[collapse.from] == Kind::seam) {
+                    collapse_remap[twin[collapse.from]] = twin[collapse.to];
+                    AddQuadric(quadrics[twin[collapse.to]], quadrics[twin[collapse.from]]);
+                }
+
+                // Later collapses this pass may not touch any triangle this one changed.
+                for (uint32_t wedge : {collapse.from, twin[collapse.from]}) {
+                    if (wedge == none) {
+                        continue;
+                    }
+                    for (uint32_t slot = offsets[wedge]; slot < offsets[wedge + 1]; slot++) {
+                        for (uint32_t corner = 0; corner < 3; corner++) {
+                            locked[remap[indices[triangles[slot] * 3 + corner]]] = true;
+                        }
+                    }
+                }
+
+                max_error = std::max(max_error, collapse.cost);
+                triangles_removed += kinds[collapse.from] == Kind::manifold ? 2 : 1;
+                collapse_count++;
+            }
+
+            if (collapse_count == 0) {
+                break;
+            }
+
+            size_t write = 0;
+            for (size_t index = 0; index < indices.size(); index += 3) {
+                uint32_t a = collapse_remap[indices[index + 0]];
+                uint32_t b = collapse_remap[indices[index + 1]];
+                uint32_t c = collapse_remap[indices[index + 2]];
+                if (remap[a] == remap[b] || remap[b] == remap[c] || remap[c] == remap[a]) {
+                    continue;
+                }
+                indices[write++] = a;
+                indices[write++] = b;
+                indices[write++] = c;
+            }
+            indices.resize(write);
+
+            for (uint32_t vertex = 0; vertex < vertex_count; vertex++) {
+                if (loop[vertex] != none && collapse_remap[loop[vertex]] != loop[vertex]) {
+                    uint32_t next = loop[vertex];
+                    loop[vertex] = collapse_remap[next] == vertex ? loop[next] : collapse_remap[next];
+                }
+                if (loop_back[vertex] != none && collapse_remap[loop_back[vertex]] != loop_back[vertex]) {
+                    uint32_t previous = loop_back[vertex];
+                    loop_back[vertex] = collapse_remap[previous] == vertex ? loop_back[previous] : collapse_remap[previous];
+                }
+            }
+
+            build_adjacency();
+        }
+
+        return static_cast<float>(std::sqrt(max_error));
+    }
+}
@@ -1,15 +1,19 @@
 #pragma once
 
-#include <thread>
 #include <atomic>
 
+#include <SDL2/SDL.h>
+
 #include "Math.h"
 #include "Utility.h"
 #include "Scene.h"
 #include "Camera.h"
+#include "JobSystem.h"
 #include "RenderEngine.h"
 #include "Geometry.h"
 #include "Geometry_Texture.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
 
 static const char* MODEL_PATH = "models/chalet.obj";
 static const char* TEXTURE_PATH = "textures/chalet.jpg";
@@ -18,8 +22,14 @@ class ModelScene : public Scene {
 public:
     ModelScene(RenderEngine& render_engine) : render_engine_(render_engine) {}
 
+    const char* GetName() {
+        return "Model";
+    }
+
     void OnQuit() {
         if (startup_) {
+            render_engine_.GetJobSystem().Wait(model_load_);
+
             vkDeviceWaitIdle(render_engine_.device_);
 
             render_engine_.DestroyGraphicsPipeline(texture_graphics_pipeline_);
@@ -41,32 +51,46 @@ public:
     void OnExit() {
     }
 
-    void Update(std::array<bool, SDL_NUM_SCANCODES>& key_state, bool mouse_capture, int mouse_x, int mouse_y) {
-        camera_.Update(key_state, mouse_capture, mouse_x, mouse_y);
-
-        static float total_time;
-        total_time += 4.0f / 1000.0f;
+    void Update(float delta_time, std::array<bool, SDL_NUM_SCANCODES>& key_state, bool mouse_capture, int mouse_x, int mouse_y) {
+        camera_.Update(delta_time, key_state, mouse_capture, mouse_x, mouse_y);
 
-        uniform_buffer_.model = glm::mat4(1.0f);
-        uniform_buffer_.model = glm::translate(uniform_buffer_.model, glm::vec3(0.0f, 0.0f, 0.0f));
-        uniform_buffer_.model = glm::rotate(uniform_buffer_.model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        uniform_buffer_.model = glm::rotate(uniform_buffer_.model, total_time * glm::radians(30.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        uniform_buffer_.view = camera_.camera_.view_matrix;
-        uniform_buffer_.proj = camera_.camera_.projection_matrix;
+        previous_time_ = time_;
+        time_ += delta_time;
     }
 
     bool EventHandler(const SDL_Event* event) {
         return false;
     }
 
-    void Render() {
+    bool IsReady() {
+        // A load job that finished without loading the model threw, and Wait rethrows it.
+        if (!model_loaded_ && model_load_.IsDone()) {
+            render_engine_.GetJobSystem().Wait(model_load_);
+        }
+        return model_loaded_ && render_engine_.IsUploadComplete(primitive_.upload_ticket_);
+    }
+
+    void Render(float alpha) {
         uint32_t image_index;
 
         if (!render_engine_.AcquireNextImage(image_index)) {
             return;
         }
 
-        VkCommandBuffer& command_buffer = render_engine_.command_buffers_[image_index];
+        camera_.Interpolate(alpha);
+
+        float time = glm::mix(previous_time_, time_, alpha);
+
+        uniform_buffer_.model = glm::mat4(1.0f);
+        uniform_buffer_.model = glm::translate(uniform_buffer_.model, glm::vec3(0.0f, 0.0f, 0.0f));
+        uniform_buffer_.model = glm::rotate(uniform_buffer_.model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+        uniform_buffer_.model = glm::rotate(uniform_buffer_.model, time * glm::radians(30.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        uniform_buffer_.view = camera_.camera_.view_matrix;
+        uniform_buffer_.proj = camera_.camera_.projection_matrix;
+
+        render_engine_.UpdateUniformBuffer(texture_uniform_buffer_, &uniform_buffer_);
+
+        VkCommandBuffer& command_buffer = render_engine_.GetCommandBuffer();
 
         VkCommandBufferBeginInfo begin_info = {};
         begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -89,22 +113,30 @@ public:
         render_pass_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
         render_pass_info.pClearValues = clear_values.data();
 
+        uint32_t zone = render_engine_.GetGpuProfiler().BeginZone(command_buffer, "Model pass");
         vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
 
-        if (model_loaded_) {
+        render_engine_.SetViewportScissor(command_buffer);
+
+        if (model_loaded_ && render_engine_.IsUploadComplete(primitive_.upload_ticket_)) {
+            const Utility::MeshLod& lod = lods_[SelectLod()];
             vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, texture_graphics_pipeline_->graphics_pipeline);
-            vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, texture_graphics_pipeline_->pipeline_layout, 0, 1, &texture_descriptor_set_->descriptor_sets[image_index], 0, nullptr);
-            render_engine_.DrawPrimitive(command_buffer, primitive_);
+            render_engine_.BindDescriptorSet(command_buffer, texture_graphics_pipeline_, image_index);
+            if (use_bindless_) {
+                render_engine_.BindBindlessTextures(command_buffer, texture_graphics_pipeline_);
+                vkCmdPushConstants(command_buffer, texture_graphics_pipeline_->pipeline_layout, VK_SHADER_STAGE_FRAGMENT_BIT, offsetof(RenderEngine::BindlessPushConstants, texture_index), sizeof(uint32_t) * 2, &push_constants_.texture_index);
+            }
+            render_engine_.BindPrimitive(command_buffer, primitive_);
+            render_engine_.DrawIndexed(command_buffer, lod.index_count, lod.first_index);
         }
 
         vkCmdEndRenderPass(command_buffer);
+        render_engine_.GetGpuProfiler().EndZone(command_buffer, zone);
 
         if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
             throw std::runtime_error("failed to record command buffer");
         }
 
-        render_engine_.UpdateUniformBuffer(texture_uniform_buffer_, image_index, &uniform_buffer_);
-
         render_engine_.SubmitDrawCommands(image_index);
 
         render_engine_.PresentImage(image_index);
@@ -129,25 +161,46 @@ private:
 
     UniformBufferObject uniform_buffer_{};
 
-    std::thread thread_object_;
+    float previous_time_ = 0.0f;
+    float time_ = 0.0f;
+
+    JobSystem::Counter model_load_{};
     std::atomic<bool> model_loaded_ = false;
     IndexedPrimitive primitive_{};
     TextureSampler texture_{};
 
+    static const size_t max_lods_ = 6;
+    // A level of detail is used once its error covers at most this many pixels on screen.
+    const float max_lod_pixel_error_ = 1.0f;
+    const float lod_near_distance_ = 0.1f;
+    std::vector<Utility::MeshLod> lods_{};
+    glm::vec3 bounds_center_{};
+    float bounds_radius_ = 0.0f;
+
+    bool use_bindless_ = false;
+    RenderEngine::BindlessPushConstants push_constants_{};
+
     void Startup() {
         render_pass_ = render_engine_.CreateRenderPass();
 
+        use_bindless_ = render_engine_.IsBindlessSupported();
+
         {
             texture_uniform_buffer_ = render_engine_.CreateUniformBuffer(sizeof(UniformBufferObject));
 
-            texture_descriptor_set_ = render_engine_.CreateDescriptorSet({texture_uniform_buffer_}, 1);
+            texture_descriptor_set_ = render_engine_.CreateDescriptorSet({texture_uniform_buffer_}, use_bindless_ ? 0 : 1);
+
+            std::vector<PushConstant> push_constants{};
+            if (use_bindless_) {
+                push_constants.push_back(PushConstant{offsetof(RenderEngine::BindlessPushConstants, texture_index), sizeof(uint32_t) * 2, VK_SHADER_STAGE_FRAGMENT_BIT});
+            }
 
             texture_graphics_pipeline_ = render_engine_.CreateGraphicsPipeline
             (
                 render_pass_,
-                "shaders/texture/vert.spv",
-                "shaders/texture/frag.spv",
-                {},
+                use_bindless_ ? "shaders/bindless/vert.spv" : "shaders/texture/vert.spv",
+                use_bindless_ ? "shaders/bindless/frag.spv" : "shaders/texture/frag.spv",
+                push_constants,
                 Vertex_Texture::getBindingDescription(),
                 Vertex_Texture::getAttributeDescriptions(),
                 texture_descriptor_set_,
@@ -155,20 +208,109 @@ private:
                 true,
                 false,
                 false,
-                false
+                use_bindless_
             );
         }
 
         render_engine_.LoadTexture(TEXTURE_PATH, texture_);
 
-        render_engine_.UpdateDescriptorSets(texture_descriptor_set_, {texture_});
+        if (use_bindless_) {
+            push_constants_.texture_index = render_engine_.RegisterBindlessTexture(texture_);
+            push_constants_.sampler_index = RenderEngine::bindless_sampler_linear;
+        } else {
+            render_engine_.UpdateDescriptorSets(texture_descriptor_set_, {texture_});
+        }
 
-        thread_object_ = std::thread([this]() {
-            std::vector<Vertex_Texture> vertices{};
-            std::vector<uint32_t> indices{};
-            Utility::LoadModel(MODEL_PATH, vertices, indices);
-            render_engine_.CreateIndexedPrimitive<Vertex_Texture, uint32_t>(vertices, indices, primitive_);
+        render_engine_.GetJobSystem().Run([this]() {
+            Utility::MeshCache mesh{};
+            if (Utility::LoadMeshCache(MODEL_PATH, mesh)) {
+                lods_ = mesh.lods;
+                SetBounds(mesh.bounds_min, mesh.bounds_max);
+                render_engine_.CreateIndexedPrimitive<Vertex_Texture, uint32_t>(mesh.vertices, mesh.vertex_count, mesh.indices, mesh.index_count, primitive_);
+                Utility::FreeMeshCache(mesh);
+            } else {
+                std::vector<Vertex_Texture> vertices{};
+                std::vector<uint32_t> indices{};
+                Utility::LoadModel(MODEL_PATH, vertices, indices, &render_engine_.GetJobSystem());
+
+                MeshOptimizer::Statistics before = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size());
+                BuildLods(vertices, indices);
+                // indices now holds every level of detail; the full mesh is the first range.
+                std::vector<uint32_t> full_mesh(indices.begin(), indices.begin() + lods_[0].index_count);
+                MeshOptimizer::Statistics after = MeshOptimizer::AnalyzeVertexCache(full_mesh, vertices.size());
+                SDL_Log("%s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", MODEL_PATH, before.acmr, after.acmr, before.atvr, after.atvr);
+
+                glm::vec3 bounds_min = vertices.empty() ? glm::vec3{0.0f} : vertices[0].pos;
+                glm::vec3 bounds_max = bounds_min;
+                for (auto& vertex : vertices) {
+                    bounds_min = glm::min(bounds_min, vertex.pos);
+                    bounds_max = glm::max(bounds_max, vertex.pos);
+                }
+                SetBounds(bounds_min, bounds_max);
+
+                // The cache only speeds up the next launch, so a read-only model directory is not an error.
+                try {
+                    Utility::WriteMeshCache(MODEL_PATH, vertices, indices, lods_);
+                } catch (const std::runtime_error&) {
+                }
+                render_engine_.CreateIndexedPrimitive<Vertex_Texture, uint32_t>(vertices, indices, primitive_);
+            }
             model_loaded_ = true;
-            });
+            }, &model_load_);
+    }
+
+    // Simplifies the model to half its triangles at a time, each level from the one before, until it
+    // stops shrinking. Every level is ordered for the vertex cache and overdraw on its own and indices
+    // ends up holding them one after another, all drawing from the same vertices.
+    void BuildLods(std::vector<Vertex_Texture>& vertices, std::vector<uint32_t>& indices) {
+        std::vector<std::vector<uint32_t>> levels{indices};
+        std::vector<float> errors{0.0f};
+        while (levels.size() < max_lods_) {
+            std::vector<uint32_t> level = levels.back();
+            float error = MeshSimplifier::Simplify(vertices, level, level.size() / 6 * 3);
+            if (level.size() > levels.back().size() * 9 / 10) {
+                break;
+            }
+
+            // Each level only knows its distance from the one it came from, so the bound adds up.
+            errors.push_back(errors.back() + error);
+            levels.push_back(std::move(level));
+        }
+
+        indices.clear();
+        lods_.clear();
+        for (size_t lod = 0; lod < levels.size(); lod++) {
+            std::vector<uint32_t> clusters{};
+            MeshOptimizer::OptimizeVertexCache(levels[lod], vertices.size(), clusters);
+            MeshOptimizer::OptimizeOverdraw(levels[lod], vertices, clusters);
+
+            lods_.push_back({static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(levels[lod].size()), errors[lod]});
+            indices.insert(indices.end(), levels[lod].begin(), levels[lod].end());
+            SDL_Log("%s: LOD %u, %u triangles, error %f", MODEL_PATH, static_cast<uint32_t>(lod), static_cast<uint32_t>(levels[lod].size() / 3), errors[lod]);
+        }
+
+        // The full mesh comes first, so vertices follow its order.
+        MeshOptimizer::OptimizeVertexFetch(vertices, indices);
+    }
+
+    void SetBounds(const glm::vec3& bounds_min, const glm::vec3& bounds_max) {
+        bounds_center_ = (bounds_min + bounds_max) * 0.5f;
+        bounds_radius_ = glm::length(bounds_max - bounds_min) * 0.5f;
+    }
+
+    // The coarsest level of detail whose error, projected at the nearest point of the model's bounding
+    // sphere, stays within max_lod_pixel_error_. The model matrix only rotates, so errors need no scaling.
+    size_t SelectLod() {
+        glm::vec4 center = uniform_buffer_.view * uniform_buffer_.model * glm::vec4(bounds_center_, 1.0f);
+        float distance = std::max(glm::length(glm::vec3(center)) - bounds_radius_, lod_near_distance_);
+        float pixels_per_unit = uniform_buffer_.proj[1][1] * render_engine_.swapchain_extent_.height * 0.5f / distance;
+
+        size_t selected = 0;
+        for (size_t lod = 1; lod < lods_.size(); lod++) {
+            if (lods_[lod].error * pixels_per_unit <= max_lod_pixel_error_) {
+                selected = lod;
+            }
+        }
+        return selected;
     }
 };
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#define PROFILE_CONCATENATE_INNER(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_INNER(a, b)
+
+// name must outlive the trace, string literals and __FUNCTION__ do.
+#define PROFILE_SCOPE(name) Profiler::Scope PROFILE_CONCATENATE(profile_scope_, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#define PROFILE_THREAD(name) Profiler::Get().SetThreadName(name)
+
+// Records scopes into per-thread buffers while a trace is running and writes them as Chrome trace events,
+// viewable in chrome://tracing or Perfetto. Recording takes no locks; only the first scope a thread
+// records takes one to register its buffer.
+class Profiler {
+public:
+    class Scope {
+    public:
+        explicit Scope(const char* name) : name_(name), start_(Profiler::Get().IsRecording() ? Profiler::Now() : -1) {}
+
+        ~Scope() {
+            if (start_ >= 0) {
+                Profiler::Get().Record(name_, start_, Profiler::Now());
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* name_;
+        int64_t start_;
+    };
+
+    static Profiler& Get() {
+        static Profiler profiler{};
+        return profiler;
+    }
+
+    // Nanoseconds since the profiler was first used.
+    static int64_t Now() {
+        static const auto epoch = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    bool IsRecording() {
+        return recording_.load(std::memory_order_relaxed);
+    }
+
+    // Discards the events of the previous trace. Each thread clears its own buffer on its next scope.
+    void Start() {
+        generation_.fetch_add(1, std::memory_order_release);
+        recording_.store(true, std::memory_order_relaxed);
+    }
+
+    void Stop() {
+        recording_.store(false, std::memory_order_relaxed);
+    }
+
+    void SetThreadName(const char* name) {
+        ThreadBuffer& buffer = CurrentBuffer();
+        std::lock_guard<std::mutex> lock(mutex_);
+        buffer.name = name;
+    }
+
+    // Scopes still open, or closed on other threads while this runs, may be left out.
+    void WriteChromeTrace(const std::string& file_name) {
+        std::ofstream file(file_name, std::ios::trunc);
+
+        if (!file.is_open()) {
+            throw std::runtime_error(std::string{"failed to open file "}+file_name);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint32_t generation = generation_.load(std::memory_order_acquire);
+
+        file << "{\"traceEvents\":[";
+        bool first = true;
+        char number[64];
+        for (auto& buffer : buffers_) {
+            file << (first ? "\n" : ",\n");
+            first = false;
+            file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer->thread_id << ",\"args\":{\"name\":\"" << Escape(buffer->name) << "\"}}";
+
+            if (buffer->generation.load(std::memory_order_acquire) != generation) {
+                continue;
+            }
+
+            for (Chunk* chunk = &buffer->head; chunk != nullptr; chunk = chunk->next.load(std::memory_order_acquire)) {
+                uint32_t count = chunk->count.load(std::memory_order_acquire);
+                for (uint32_t index = 0; index < count; index++) {
+                    Event& event = chunk->events[index];
+                    snprintf(number, sizeof(number), "\"ts\":%.3f,\"dur\":%.3f", event.start / 1000.0, (event.end - event.start) / 1000.0);
+                    file << ",\n{\"name\":\"" << Escape(event.name) << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->thread_id << "," << number << "}";
+                }
+            }
+        }
+        file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+        file.close();
+    }
+
+private:
+    static const uint32_t chunk_size_ = 4096;
+
+    struct Event {
+        const char* name;
+        int64_t start;
+        int64_t end;
+    };
+
+    // Written only by the owning thread; count is published after the event so readers never see a
+    // partly written one.
+    struct Chunk {
+        std::array<Event, chunk_size_> events{};
+        std::atomic<uint32_t> count{};
+        std::atomic<Chunk*> next{};
+
+        ~Chunk() {
+            delete next.load();
+        }
+    };
+
+    struct ThreadBuffer {
+        uint32_t thread_id{};
+        std::string name{};
+        std::atomic<uint32_t> generation{};
+        Chunk head{};
+        Chunk* tail{&head};
+    };
+
+    std::atomic<bool> recording_{};
+    std::atomic<uint32_t> generation_{};
+    std::mutex mutex_{};
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_{};
+
+    // Buffers are owned by the profiler so they outlive the threads that filled them.
+    ThreadBuffer& CurrentBuffer() {
+        static thread_local ThreadBuffer* buffer = nullptr;
+        if (buffer == nullptr) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            buffers_.push_back(std::make_unique<ThreadBuffer>());
+            buffer = buffers_.back().get();
+            buffer->thread_id = static_cast<uint32_t>(buffers_.size() - 1);
+            buffer->name = "Thread " + std::to_string(buffer->thread_id);
+        }
+        return *buffer;
+    }
+
+    void Record(const char* name, int64_t start, int64_t end) {
+        ThreadBuffer& buffer = CurrentBuffer();
+
+        // Chunks from an earlier trace are kept and refilled.
+        uint32_t generation = generation_.load(std::memory_order_acquire);
+        if (buffer.generation.load(std::memory_order_relaxed) != generation) {
+            for (Chunk* chunk = &buffer.head; chunk != nullptr; chunk = chunk->next.load(std::memory_order_relaxed)) {
+                chunk->count.store(0, std::memory_order_relaxed);
+            }
+            buffer.tail = &buffer.head;
+            buffer.generation.store(generation, std::memory_order_release);
+        }
+
+        Chunk* chunk = buffer.tail;
+        uint32_t count = chunk->count.load(std::memory_order_relaxed);
+        if (count == chunk_size_) {
+            Chunk* next = chunk->next.load(std::memory_order_relaxed);
+            if (next == nullptr) {
+                next = new Chunk{};
+                chunk->next.store(next, std::memory_order_release);
+            }
+            buffer.tail = next;
+            chunk = next;
+            count = 0;
+        }
+
+        chunk->events[count] = {name, start, end};
+        chunk->count.store(count + 1, std::memory_order_release);
+    }
+
+    static std::string Escape(const std::string& text) {
+        std::string escaped{};
+        for (char character : text) {
+            if (character == '"' || character == '\\') {
+                escaped += '\\';
+            }
+            escaped += character;
+        }
+        return escaped;
+    }
+};
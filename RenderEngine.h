@@ -2,13 +2,28 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
 #include <set>
 #include <stdexcept>
+#include <string>
+#include <tuple>
 #include <vector>
 
 #include <vulkan/vulkan.h>
 #pragma comment(lib, "vulkan-1.lib")
 
+#include "DescriptorAllocator.h"
+#include "FrameCapture.h"
+#include "FrameStatistics.h"
+#include "GpuProfiler.h"
+#include "JobSystem.h"
+#include "MemoryAllocator.h"
+#include "Profiler.h"
 #include "Utility.h"
 
 struct PushConstant {
@@ -21,21 +36,24 @@ struct TextureSampler {
     VkSampler texture_sampler_{};
     VkImageView texture_image_view_{};
     VkImage texture_image_{};
-    VkDeviceMemory texture_image_memory_{};
+    Allocation texture_image_memory_{};
+    uint64_t upload_ticket_{};
+    uint32_t bindless_index_{UINT32_MAX};
 };
 
 struct IndexedPrimitive {
     VkBuffer vertex_buffer_{};
-    VkDeviceMemory vertex_buffer_memory_{};
+    Allocation vertex_buffer_memory_{};
     VkBuffer index_buffer_{};
-    VkDeviceMemory index_buffer_memory_{};
+    Allocation index_buffer_memory_{};
     uint32_t index_count_{};
+    uint64_t upload_ticket_{};
 };
 
 struct Buffer {
     VkDeviceSize size{};
     VkBuffer buffer{};
-    VkDeviceMemory memory{};
+    Allocation memory{};
 };
 
 class RenderApplication {
@@ -49,16 +67,14 @@ class RenderEngine {
 public:
     struct UniformBuffer {
         uint32_t size_{};
-        std::vector<VkBuffer> buffers{};
-        std::vector<VkDeviceMemory> memories{};
+        uint32_t offset_{};
     };
 
     struct DescriptorSet {
         std::vector<std::shared_ptr<UniformBuffer>> uniform_buffers{};
         uint32_t image_sampler_count{};
         VkDescriptorSetLayout descriptor_set_layout{};
-        VkDescriptorPool descriptor_pool{};
-        std::vector<VkDescriptorSet> descriptor_sets{};
+        std::vector<DescriptorAllocation> descriptor_sets{};
     };
 
     struct GraphicsPipeline {
@@ -71,22 +87,33 @@ public:
         uint32_t subpass{};
         bool use_depth{};
         bool use_alpha{};
-        bool use_dynamic_state{};
         bool use_no_culling{};
+        bool use_bindless{};
         VkPipelineLayout pipeline_layout{};
         VkPipeline graphics_pipeline{};
     };
 
     struct RenderPass {
         std::vector<std::shared_ptr<GraphicsPipeline>> graphics_pipelines_;
+        uint32_t subpass_count_{};
+        bool load_{};
         VkRenderPass render_pass_{};
         std::vector<VkFramebuffer> framebuffers_{};
     };
 
+    static const uint32_t bindless_sampler_linear = 0;
+    static const uint32_t bindless_sampler_nearest = 1;
+    static const uint32_t bindless_sampler_count = 2;
+
+    struct BindlessPushConstants {
+        glm::vec2 position{};
+        uint32_t texture_index{};
+        uint32_t sampler_index{};
+    };
+
     VkPhysicalDeviceLimits limits_;
     VkDevice device_ = nullptr;
     VkExtent2D swapchain_extent_{};
-    std::vector<VkCommandBuffer> command_buffers_{};
 
     void Initialize(RenderApplication* render_application) {
 #ifdef _DEBUG
@@ -94,47 +121,78 @@ public:
 #endif
         render_application_ = render_application;
         std::vector<const char*> required_extensions{};
-        render_application_->GetRequiredExtensions(required_extensions);
+        if (headless_) {
+            device_extensions_.clear();
+        } else {
+            render_application_->GetRequiredExtensions(required_extensions);
+        }
         CreateInstance(required_extensions);
         if (debug_layers_) {
             SetupDebugMessenger();
         }
-        render_application_->CreateSurface(instance_, surface_);
+        if (!headless_) {
+            render_application_->CreateSurface(instance_, surface_);
+        }
         PickPhysicalDevice();
         msaa_samples_ = GetMaxUsableSampleCount();
+        job_system_.Initialize(std::max(std::thread::hardware_concurrency(), 2u) - 1);
         CreateLogicalDevice();
-        CreateCommandPool();
-        int window_width;
-        int window_height;
-        render_application_->GetDrawableSize(window_width, window_height);
-        ChooseSwapExtent(window_width, window_height);
-        image_count_ = capabilities_.minImageCount > 2 ? capabilities_.minImageCount : 2;
-        std::vector<VkSurfaceFormatKHR> formats;
-        std::vector<VkPresentModeKHR> present_modes;
-        QuerySwapChainSupport(physical_device_, capabilities_, formats, present_modes);
-        if (capabilities_.maxImageCount > 0 && image_count_ > capabilities_.maxImageCount) {
-            image_count_ = capabilities_.maxImageCount;
+        allocator_.Initialize(physical_device_, device_);
+        CreatePipelineCache();
+        CreateUploadBatches();
+        int window_width = headless_extent_.width;
+        int window_height = headless_extent_.height;
+        if (headless_) {
+            // One image per frame slot, so the frame fence also guards reuse of the image.
+            image_count_ = max_frames_in_flight_;
+            surface_format_ = {VK_FORMAT_B8G8R8A8_SRGB, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR};
+        } else {
+            render_application_->GetDrawableSize(window_width, window_height);
+            ChooseSwapExtent(window_width, window_height);
+            image_count_ = capabilities_.minImageCount > 2 ? capabilities_.minImageCount : 2;
+            std::vector<VkSurfaceFormatKHR> formats;
+            std::vector<VkPresentModeKHR> present_modes;
+            QuerySwapChainSupport(physical_device_, capabilities_, formats, present_modes);
+            if (capabilities_.maxImageCount > 0 && image_count_ > capabilities_.maxImageCount) {
+                image_count_ = capabilities_.maxImageCount;
+            }
+            surface_format_ = ChooseSwapSurfaceFormat(formats);
+            present_mode_ = ChooseSwapPresentMode(present_modes);
         }
-        surface_format_ = ChooseSwapSurfaceFormat(formats);
-        present_mode_ = ChooseSwapPresentMode(present_modes);
         depth_format_ = FindDepthFormat();
         CreateSwapchain(window_width, window_height);
-        CreateSyncObjects();
+        CreateFrameContexts();
+        CreateGpuProfiler();
+        CreateUniformArena();
+        CreateDescriptorAllocators();
+        if (bindless_supported_) {
+            CreateBindlessTable();
+        }
     }
 
     void Destroy() {
-        for (auto& render_pass : render_passes_) {
-            DestroyRenderPass(render_pass);
-        }
-        for (size_t i = 0; i < max_frames_in_flight_; i++) {
-            vkDestroySemaphore(device_, render_finished_semaphores_[i], nullptr);
-            vkDestroySemaphore(device_, image_available_semaphores_[i], nullptr);
-            vkDestroyFence(device_, in_flight_fences_[i], nullptr);
+        if (capturing_) {
+            StopCapture();
         }
+        DestroyFramebufferCache();
+        DestroyRenderPassCache();
+        render_passes_.clear();
         DestroySwapchain();
-        vkDestroyCommandPool(device_, command_pool_, nullptr);
+        if (bindless_supported_) {
+            DestroyBindlessTable();
+        }
+        DestroyDescriptorAllocators();
+        DestroyUniformArena();
+        DestroyUploadBatches();
+        DestroyFrameContexts();
+        gpu_profiler_.Destroy();
+        DestroyPipelineCache();
+        allocator_.Destroy();
         vkDestroyDevice(device_, nullptr);
-        vkDestroySurfaceKHR(instance_, surface_, nullptr);
+        job_system_.Destroy();
+        if (!headless_) {
+            vkDestroySurfaceKHR(instance_, surface_, nullptr);
+        }
         if (debug_layers_) {
             DestroyDebugUtilsMessengerEXT(instance_, debug_messenger_, nullptr);
         }
@@ -142,38 +200,288 @@ public:
     }
 
     void RebuildSwapchain() {
-        vkDeviceWaitIdle(device_);
-        for (auto& render_pass : render_passes_) {
-            for (auto& graphics_pipeline : render_pass->graphics_pipelines_) {
-                ResetGraphicsPipeline(graphics_pipeline);
-            }
+        if (headless_) {
+            return;
         }
+
+        vkDeviceWaitIdle(device_);
         int window_width;
         int window_height;
         render_application_->GetDrawableSize(window_width, window_height);
-        if (swapchain_extent_.width != window_width || swapchain_extent_.height != window_height) {
+
+        std::vector<VkSurfaceFormatKHR> formats;
+        std::vector<VkPresentModeKHR> present_modes;
+        QuerySwapChainSupport(physical_device_, capabilities_, formats, present_modes);
+        VkSurfaceFormatKHR surface_format = ChooseSwapSurfaceFormat(formats);
+        VkPresentModeKHR present_mode = ChooseSwapPresentMode(present_modes);
+        bool format_changed = surface_format.format != surface_format_.format || surface_format.colorSpace != surface_format_.colorSpace;
+
+        if (!format_changed && present_mode == present_mode_ && swapchain_extent_.width == window_width && swapchain_extent_.height == window_height) {
+            return;
+        }
+
+        if (capturing_) {
+            CollectCaptures();
+            frame_capture_.Flush();
+            DestroyCaptureBuffers();
+        }
+
+        DestroyFramebufferCache();
+        DestroySwapchain();
+        surface_format_ = surface_format;
+        present_mode_ = present_mode;
+        CreateSwapchain(window_width, window_height);
+
+        if (capturing_) {
+            CreateCaptureBuffers();
+        }
+
+        // Viewport and scissor are dynamic, so pipelines only depend on the render pass, which only
+        // depends on the attachment formats and sample count.
+        if (format_changed) {
             for (auto& render_pass : render_passes_) {
-                for (auto framebuffer : render_pass->framebuffers_) {
-                    vkDestroyFramebuffer(device_, framebuffer, nullptr);
+                for (auto& graphics_pipeline : render_pass->graphics_pipelines_) {
+                    ResetGraphicsPipeline(graphics_pipeline);
                 }
             }
-            DestroySwapchain();
-            CreateSwapchain(window_width, window_height);
-            for (auto& render_pass : render_passes_) {
-                CreateFramebuffers(render_pass->render_pass_, render_pass->framebuffers_);
-            }
+            DestroyRenderPassCache();
         }
+
         for (auto& render_pass : render_passes_) {
-            for (auto& graphics_pipeline : render_pass->graphics_pipelines_) {
-                RebuildGraphicsPipeline(render_pass, graphics_pipeline);
+            if (render_pass->subpass_count_ == 0) {
+                continue;
+            }
+            AcquireRenderPass(render_pass);
+            if (format_changed) {
+                for (auto& graphics_pipeline : render_pass->graphics_pipelines_) {
+                    RebuildGraphicsPipeline(render_pass, graphics_pipeline);
+                }
             }
         }
     }
 
+    void SetViewportScissor(VkCommandBuffer& command_buffer) {
+        VkViewport viewport = {};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = (float)swapchain_extent_.width;
+        viewport.height = (float)swapchain_extent_.height;
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+
+        VkRect2D scissor = {};
+        scissor.offset = {0, 0};
+        scissor.extent = swapchain_extent_;
+        vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+    }
+
+    // Must be called before Initialize. Renders into offscreen images of the given size instead of a
+    // swapchain, so no window, surface or VK_KHR_swapchain is needed. Scenes drive frames exactly as they
+    // would with a window.
+    void SetHeadless(uint32_t width, uint32_t height) {
+        if (device_ != nullptr) {
+            throw std::runtime_error("headless mode cannot change after initialization");
+        }
+        headless_ = true;
+        headless_extent_ = {width, height};
+    }
+
+    bool IsHeadless() {
+        return headless_;
+    }
+
+    // Must be called before Initialize.
+    void SetFramesInFlight(uint32_t frames_in_flight) {
+        if (frames_in_flight < 1 || frames_in_flight > max_supported_frames_in_flight_) {
+            throw std::runtime_error("frames in flight must be between 1 and 4");
+        }
+        if (device_ != nullptr) {
+            throw std::runtime_error("frames in flight cannot change after initialization");
+        }
+        max_frames_in_flight_ = frames_in_flight;
+    }
+
+    uint32_t GetFramesInFlight() {
+        return max_frames_in_flight_;
+    }
+
+    // Falls back to FIFO, the only mode every device supports, when the surface lacks the requested one.
+    // Changing it after initialization rebuilds the swapchain.
+    void SetPresentMode(VkPresentModeKHR present_mode) {
+        requested_present_mode_ = present_mode;
+        if (device_ != nullptr) {
+            RebuildSwapchain();
+        }
+    }
+
+    VkPresentModeKHR GetPresentMode() {
+        return present_mode_;
+    }
+
+    // Blocks until the GPU has finished the last submitted frame. Calling this right before sampling input
+    // keeps the CPU from queueing frames ahead, trading throughput for input latency.
+    void WaitForPreviousFrame() {
+        auto start_time = std::chrono::steady_clock::now();
+        FrameContext& frame = frames_[(current_frame_ + max_frames_in_flight_ - 1) % max_frames_in_flight_];
+        vkWaitForFences(device_, 1, &frame.in_flight_fence, VK_TRUE, UINT64_MAX);
+        acquire_wait_ms_ += MillisecondsSince(start_time);
+    }
+
+    // Copies every presented frame into a pool of host-visible buffers and writes it out as
+    // prefix000000.png (or .rgba) on a background thread once the frame's fence has passed. Frames are
+    // dropped rather than stalling when every buffer is still waiting on the encoder.
+    void StartCapture(const std::string& prefix, FrameCapture::Format format) {
+        if (capturing_) {
+            return;
+        }
+        if (surface_format_.format != VK_FORMAT_B8G8R8A8_SRGB && surface_format_.format != VK_FORMAT_B8G8R8A8_UNORM &&
+            surface_format_.format != VK_FORMAT_R8G8B8A8_SRGB && surface_format_.format != VK_FORMAT_R8G8B8A8_UNORM) {
+            throw std::runtime_error("frame capture needs an 8-bit RGBA or BGRA swapchain");
+        }
+        if (!headless_ && !(capabilities_.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)) {
+            throw std::runtime_error("frame capture needs swapchain images that can be copied from");
+        }
+
+        CreateCaptureBuffers();
+        capture_frame_number_ = 0;
+        captures_dropped_ = 0;
+        frame_capture_.Start(prefix, format, [this](uint32_t buffer) {
+            std::lock_guard<std::mutex> lock(capture_mutex_);
+            free_capture_buffers_.push_back(buffer);
+        });
+        capturing_ = true;
+    }
+
+    // Waits for the frames still in flight and writes them before returning.
+    void StopCapture() {
+        if (!capturing_) {
+            return;
+        }
+
+        vkDeviceWaitIdle(device_);
+        CollectCaptures();
+        frame_capture_.Stop();
+        DestroyCaptureBuffers();
+        capturing_ = false;
+    }
+
+    bool IsCapturing() {
+        return capturing_;
+    }
+
+    // Frames of the last capture that were skipped for lack of a free buffer or failed to write.
+    uint32_t GetCapturesDropped() {
+        return captures_dropped_ + frame_capture_.GetFailedFrames();
+    }
+
+    // The command buffer of the frame slot acquired by the last AcquireNextImage.
+    VkCommandBuffer& GetCommandBuffer() {
+        return frames_[current_frame_].command_buffer;
+    }
+
+    JobSystem& GetJobSystem() {
+        return job_system_;
+    }
+
+    GpuProfiler& GetGpuProfiler() {
+        return gpu_profiler_;
+    }
+
+    // Acquire covers the fence waits of AcquireNextImage and WaitForPreviousFrame as well as the acquire.
+    FrameStatistics& GetFrameStatistics() {
+        return frame_statistics_;
+    }
+
+    // Time the frame begun by the last AcquireNextImage has spent blocked so far, in fence waits, the
+    // acquire and the present.
+    float GetFrameWaitMs() {
+        return acquire_wait_ms_ + present_wait_ms_;
+    }
+
+    // The frame slot the commands being recorded belong to, in [0, GetFramesInFlight()).
+    uint32_t GetCurrentFrame() {
+        return static_cast<uint32_t>(current_frame_);
+    }
+
+    // overlay records a render pass drawn over every frame after the scene's command buffer, in a
+    // command buffer the engine begins and ends. Pass nullptr to remove it.
+    void SetOverlay(std::function<void(VkCommandBuffer&, uint32_t)> overlay) {
+        overlay_ = overlay;
+    }
+
+    // Records one secondary command buffer per entry of subpasses as parallel jobs. Buffer i
+    // continues subpasses[i] of render_pass and already has the viewport and scissor set. Execute the
+    // returned buffers with vkCmdExecuteCommands inside subpasses begun with
+    // VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS. Update uniform buffers before calling this, the
+    // uniform arena is not thread safe, and do not wait on jobs inside record.
+    std::vector<VkCommandBuffer> RecordSecondaryCommandBuffers(std::shared_ptr<RenderPass>& render_pass, uint32_t image_index, const std::vector<uint32_t>& subpasses, const std::function<void(uint32_t, VkCommandBuffer&)>& record) {
+        FrameContext& frame = frames_[current_frame_];
+        std::vector<VkCommandBuffer> command_buffers(subpasses.size());
+
+        job_system_.ParallelFor(static_cast<uint32_t>(subpasses.size()), 1, [&](uint32_t index, uint32_t worker) {
+            VkCommandBuffer& command_buffer = command_buffers[index];
+            command_buffer = GetSecondaryCommandBuffer(frame.secondary_command_pools[worker]);
+
+            VkCommandBufferInheritanceInfo inheritance_info = {};
+            inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+            inheritance_info.renderPass = render_pass->render_pass_;
+            inheritance_info.subpass = subpasses[index];
+            inheritance_info.framebuffer = render_pass->framebuffers_[image_index];
+
+            VkCommandBufferBeginInfo begin_info = {};
+            begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+            begin_info.pInheritanceInfo = &inheritance_info;
+
+            if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS) {
+                throw std::runtime_error("failed to begin recording secondary command buffer");
+            }
+
+            SetViewportScissor(command_buffer);
+            record(index, command_buffer);
+
+            if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to record secondary command buffer");
+            }
+        });
+
+        return command_buffers;
+    }
+
     bool AcquireNextImage(uint32_t& image_index) {
-        vkWaitForFences(device_, 1, &in_flight_fences_[current_frame_], VK_TRUE, UINT64_MAX);
+        PROFILE_FUNCTION();
+
+        auto start_time = std::chrono::steady_clock::now();
+        RecordFrameStatistics(start_time);
+
+        FrameContext& frame = frames_[current_frame_];
+
+        vkWaitForFences(device_, 1, &frame.in_flight_fence, VK_TRUE, UINT64_MAX);
+        acquire_wait_ms_ += MillisecondsSince(start_time);
+
+        CollectCapture(frame);
+        if (gpu_profiler_.Resolve(static_cast<uint32_t>(current_frame_))) {
+            frame_statistics_.Add(FrameStatistics::Metric::gpu, gpu_profiler_.GetLastFrameMs());
+        }
+        draw_calls_ = 0;
 
-        VkResult result = vkAcquireNextImageKHR(device_, swapchain_, UINT64_MAX, image_available_semaphores_[current_frame_], VK_NULL_HANDLE, &image_index);
+        vkResetCommandPool(device_, frame.command_pool, 0);
+        for (auto& secondary : frame.secondary_command_pools) {
+            vkResetCommandPool(device_, secondary.command_pool, 0);
+            secondary.used = 0;
+        }
+        uniform_arena_head_ = 0;
+        frame.transient_descriptor_allocator->Reset();
+
+        if (headless_) {
+            image_index = static_cast<uint32_t>(current_frame_);
+            return true;
+        }
+
+        auto acquire_time = std::chrono::steady_clock::now();
+        VkResult result = vkAcquireNextImageKHR(device_, swapchain_, UINT64_MAX, frame.image_available_semaphore, VK_NULL_HANDLE, &image_index);
+        acquire_wait_ms_ += MillisecondsSince(acquire_time);
 
         if (result == VK_ERROR_OUT_OF_DATE_KHR) {
             RebuildSwapchain();
@@ -190,7 +498,18 @@ public:
         VkDeviceSize offsets[] = {0};
         vkCmdBindVertexBuffers(command_buffer, 0, 1, vertex_buffers, offsets);
         vkCmdBindIndexBuffer(command_buffer, primitive.index_buffer_, 0, VK_INDEX_TYPE_UINT32);
-        vkCmdDrawIndexed(command_buffer, primitive.index_count_, 1, 0, 0, 0);
+        DrawIndexed(command_buffer, primitive.index_count_);
+    }
+
+    // Counted in GetDrawCalls, unlike calling vkCmdDrawIndexed directly. Safe to call from recording jobs.
+    void DrawIndexed(VkCommandBuffer& command_buffer, uint32_t index_count, uint32_t first_index = 0, int32_t vertex_offset = 0) {
+        draw_calls_++;
+        vkCmdDrawIndexed(command_buffer, index_count, 1, first_index, vertex_offset, 0);
+    }
+
+    // Draws recorded since the last AcquireNextImage.
+    uint32_t GetDrawCalls() {
+        return draw_calls_;
     }
 
     void BindPrimitive(VkCommandBuffer& command_buffer, IndexedPrimitive& primitive) {
@@ -201,36 +520,59 @@ public:
     }
 
     void SubmitDrawCommands(uint32_t image_index) {
-        if (images_in_flight_[image_index] != VK_NULL_HANDLE) {
-            vkWaitForFences(device_, 1, &images_in_flight_[image_index], VK_TRUE, UINT64_MAX);
-        }
-        images_in_flight_[image_index] = in_flight_fences_[current_frame_];
+        PROFILE_FUNCTION();
+
+        FlushUploads();
+
+        FrameContext& frame = frames_[current_frame_];
 
         VkSubmitInfo submit_info = {};
         submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-        VkSemaphore wait_semaphores[] = {image_available_semaphores_[current_frame_]};
+        // Offscreen images are neither acquired nor presented, so there is nothing to wait on or signal.
+        VkSemaphore wait_semaphores[] = {frame.image_available_semaphore};
         VkPipelineStageFlags wait_stages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        submit_info.waitSemaphoreCount = 1;
+        submit_info.waitSemaphoreCount = headless_ ? 0 : 1;
         submit_info.pWaitSemaphores = wait_semaphores;
         submit_info.pWaitDstStageMask = wait_stages;
 
-        submit_info.commandBufferCount = 1;
-        submit_info.pCommandBuffers = &command_buffers_[image_index];
+        // The profiler's query reset has to run before the scene's command buffer writes any timestamps.
+        std::array<VkCommandBuffer, 4> command_buffers{};
+        uint32_t command_buffer_count = 0;
+        if (RecordProfilerReset(frame)) {
+            command_buffers[command_buffer_count++] = frame.profiler_command_buffer;
+        }
+        command_buffers[command_buffer_count++] = frame.command_buffer;
+        if (overlay_) {
+            RecordOverlay(frame, image_index);
+            command_buffers[command_buffer_count++] = frame.overlay_command_buffer;
+        }
+        if (capturing_ && RecordCapture(frame, image_index)) {
+            command_buffers[command_buffer_count++] = frame.capture_command_buffer;
+        }
+        submit_info.commandBufferCount = command_buffer_count;
+        submit_info.pCommandBuffers = command_buffers.data();
 
-        VkSemaphore signal_semaphores[] = {render_finished_semaphores_[current_frame_]};
-        submit_info.signalSemaphoreCount = 1;
+        VkSemaphore signal_semaphores[] = {frame.render_finished_semaphore};
+        submit_info.signalSemaphoreCount = headless_ ? 0 : 1;
         submit_info.pSignalSemaphores = signal_semaphores;
 
-        vkResetFences(device_, 1, &in_flight_fences_[current_frame_]);
+        vkResetFences(device_, 1, &frame.in_flight_fence);
 
-        if (vkQueueSubmit(graphics_queue_, 1, &submit_info, in_flight_fences_[current_frame_]) != VK_SUCCESS) {
+        if (vkQueueSubmit(graphics_queue_, 1, &submit_info, frame.in_flight_fence) != VK_SUCCESS) {
             throw std::runtime_error("failed to submit draw command buffer");
         }
     }
 
     void PresentImage(uint32_t image_index) {
-        VkSemaphore signal_semaphores[] = {render_finished_semaphores_[current_frame_]};
+        PROFILE_FUNCTION();
+
+        if (headless_) {
+            current_frame_ = (current_frame_ + 1) % max_frames_in_flight_;
+            return;
+        }
+
+        VkSemaphore signal_semaphores[] = {frames_[current_frame_].render_finished_semaphore};
         VkPresentInfoKHR present_info = {};
         present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
         present_info.waitSemaphoreCount = 1;
@@ -240,7 +582,9 @@ public:
         present_info.pSwapchains = swap_chains;
         present_info.pImageIndices = &image_index;
 
+        auto start_time = std::chrono::steady_clock::now();
         VkResult result = vkQueuePresentKHR(present_queue_, &present_info);
+        present_wait_ms_ += MillisecondsSince(start_time);
 
         if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
             RebuildSwapchain();
@@ -251,8 +595,11 @@ public:
         current_frame_ = (current_frame_ + 1) % max_frames_in_flight_;
     }
 
-    std::shared_ptr<RenderPass> CreateRenderPass() {
+    // A loading render pass draws over what the previous pass left in the color attachment instead of
+    // clearing it.
+    std::shared_ptr<RenderPass> CreateRenderPass(bool load = false) {
         std::shared_ptr<RenderPass> render_pass = std::make_shared<RenderPass>();
+        render_pass->load_ = load;
         render_passes_.push_back(render_pass);
         return render_pass;
     }
@@ -260,41 +607,57 @@ public:
     std::shared_ptr<UniformBuffer> CreateUniformBuffer(uint32_t buffer_size) {
         std::shared_ptr<UniformBuffer> uniform_buffer = std::make_shared<UniformBuffer>();
         uniform_buffer->size_ = buffer_size;
-        uniform_buffer->buffers.resize(image_count_);
-        uniform_buffer->memories.resize(image_count_);
-        for (size_t i = 0; i < image_count_; i++) {
-            CreateBuffer(buffer_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniform_buffer->buffers[i], uniform_buffer->memories[i]);
-        }
         return uniform_buffer;
     }
 
     void DestroyUniformBuffer(std::shared_ptr<UniformBuffer>& uniform_buffer) {
-        for (size_t i = 0; i < uniform_buffer->buffers.size(); i++) {
-            vkDestroyBuffer(device_, uniform_buffer->buffers[i], nullptr);
-            vkFreeMemory(device_, uniform_buffer->memories[i], nullptr);
-        }
         uniform_buffer.reset();
     }
 
-    void UpdateUniformBuffer(std::shared_ptr<UniformBuffer>& uniform_buffer, uint32_t image_index, void* data) {
-        void* memory;
-        vkMapMemory(device_, uniform_buffer->memories[image_index], 0, uniform_buffer->size_, 0, &memory);
-        memcpy(memory, data, uniform_buffer->size_);
-        vkUnmapMemory(device_, uniform_buffer->memories[image_index]);
+    // Copies the data into the current frame's slice of the uniform arena. Must be called before the
+    // descriptor set that references the uniform buffer is bound, as the offset is captured at bind time.
+    void UpdateUniformBuffer(std::shared_ptr<UniformBuffer>& uniform_buffer, void* data) {
+        VkDeviceSize alignment = limits_.minUniformBufferOffsetAlignment;
+        VkDeviceSize offset = (uniform_arena_head_ + alignment - 1) / alignment * alignment;
+
+        if (offset + uniform_buffer->size_ > uniform_arena_frame_size_) {
+            throw std::runtime_error("uniform arena exhausted");
+        }
+
+        uniform_arena_head_ = offset + uniform_buffer->size_;
+
+        VkDeviceSize frame_offset = current_frame_ * uniform_arena_frame_size_ + offset;
+        memcpy(static_cast<char*>(uniform_arena_memory_.mapped) + frame_offset, data, uniform_buffer->size_);
+        uniform_buffer->offset_ = static_cast<uint32_t>(frame_offset);
+    }
+
+    void BindDescriptorSet(VkCommandBuffer& command_buffer, std::shared_ptr<GraphicsPipeline>& graphics_pipeline, uint32_t image_index) {
+        BindDescriptorSet(command_buffer, graphics_pipeline, graphics_pipeline->descriptor_set->descriptor_sets[image_index].set);
     }
 
-    void UpdateUniformBuffers(std::shared_ptr<UniformBuffer>& uniform_buffer, void* data) {
-        void* memory;
-        for (uint32_t image_index = 0; image_index < image_count_; image_index++) {
-            vkMapMemory(device_, uniform_buffer->memories[image_index], 0, uniform_buffer->size_, 0, &memory);
-            memcpy(memory, data, uniform_buffer->size_);
-            vkUnmapMemory(device_, uniform_buffer->memories[image_index]);
+    void BindDescriptorSet(VkCommandBuffer& command_buffer, std::shared_ptr<GraphicsPipeline>& graphics_pipeline, VkDescriptorSet descriptor_set_handle) {
+        std::shared_ptr<DescriptorSet>& descriptor_set = graphics_pipeline->descriptor_set;
+
+        std::array<uint32_t, max_uniform_buffers_per_set_> dynamic_offsets{};
+        uint32_t dynamic_offset_count = static_cast<uint32_t>(descriptor_set->uniform_buffers.size());
+
+        for (uint32_t index = 0; index < dynamic_offset_count; index++) {
+            dynamic_offsets[index] = descriptor_set->uniform_buffers[index]->offset_;
         }
+
+        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline->pipeline_layout, 0, 1, &descriptor_set_handle, dynamic_offset_count, dynamic_offsets.data());
     }
 
     std::shared_ptr<DescriptorSet> CreateDescriptorSet(std::vector<std::shared_ptr<UniformBuffer>> uniform_buffers, uint32_t image_sampler_count) {
         std::shared_ptr<DescriptorSet> descriptor_set = std::make_shared<DescriptorSet>();
 
+        if (uniform_buffers.size() > max_uniform_buffers_per_set_) {
+            throw std::runtime_error("too many uniform buffers in descriptor set");
+        }
+        if (image_sampler_count > max_image_samplers_per_set_) {
+            throw std::runtime_error("too many image samplers in descriptor set");
+        }
+
         descriptor_set->uniform_buffers = uniform_buffers;
         descriptor_set->image_sampler_count = image_sampler_count;
 
@@ -306,7 +669,7 @@ public:
             VkDescriptorSetLayoutBinding uniform_layout_binding = {};
             uniform_layout_binding.binding = binding++;
             uniform_layout_binding.descriptorCount = 1;
-            uniform_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            uniform_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
             uniform_layout_binding.pImmutableSamplers = nullptr;
             uniform_layout_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
             bindings.push_back(uniform_layout_binding);
@@ -322,151 +685,102 @@ public:
             bindings.push_back(sampler_layout_binding);
         }
 
-        VkDescriptorSetLayoutCreateInfo layout_info = {};
-        layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        layout_info.bindingCount = static_cast<uint32_t>(bindings.size());
-        layout_info.pBindings = bindings.data();
-
-        if (vkCreateDescriptorSetLayout(device_, &layout_info, nullptr, &descriptor_set->descriptor_set_layout) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create descriptor set layout");
-        }
-
-        std::vector<VkDescriptorPoolSize> pool_sizes{};
-
-        for (auto& uniform_buffer : uniform_buffers) {
-            VkDescriptorPoolSize pool_size{};
-            pool_size.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            pool_size.descriptorCount = static_cast<uint32_t>(image_count_);
-            pool_sizes.push_back(pool_size);
-        }
-
-        for (uint32_t index = 0; index < image_sampler_count; index++) {
-            VkDescriptorPoolSize pool_size{};
-            pool_size.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            pool_size.descriptorCount = static_cast<uint32_t>(image_count_);
-            pool_sizes.push_back(pool_size);
-        }
-
-        VkDescriptorPoolCreateInfo pool_info = {};
-        pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-        pool_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
-        pool_info.pPoolSizes = pool_sizes.data();
-        pool_info.maxSets = static_cast<uint32_t>(image_count_);
-
-        if (vkCreateDescriptorPool(device_, &pool_info, nullptr, &descriptor_set->descriptor_pool) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create descriptor pool");
-        }
-
-        std::vector<VkDescriptorSetLayout> layouts(image_count_, descriptor_set->descriptor_set_layout);
-
-        VkDescriptorSetAllocateInfo allocate_info = {};
-        allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        allocate_info.descriptorPool = descriptor_set->descriptor_pool;
-        allocate_info.descriptorSetCount = static_cast<uint32_t>(image_count_);
-        allocate_info.pSetLayouts = layouts.data();
+        descriptor_set->descriptor_set_layout = descriptor_layout_cache_.GetLayout(bindings);
 
         descriptor_set->descriptor_sets.resize(image_count_);
 
-        if (vkAllocateDescriptorSets(device_, &allocate_info, descriptor_set->descriptor_sets.data()) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate descriptor sets");
+        for (uint32_t image_index = 0; image_index < image_count_; image_index++) {
+            descriptor_set->descriptor_sets[image_index] = descriptor_allocator_.Allocate(descriptor_set->descriptor_set_layout);
         }
 
-        std::vector<VkWriteDescriptorSet> descriptor_writes = {};
-
         if (image_sampler_count == 0 && uniform_buffers.size() > 0) {
-            uint32_t uniform_buffer_count = static_cast<uint32_t>(uniform_buffers.size());
-            VkDescriptorBufferInfo* buffer_info = new VkDescriptorBufferInfo[image_count_ * uniform_buffer_count];
-
             for (uint32_t image_index = 0; image_index < image_count_; image_index++) {
-                for (uint32_t uniform_buffer_index = 0; uniform_buffer_index < uniform_buffer_count; uniform_buffer_index++) {
-                    buffer_info[image_index * uniform_buffer_count + uniform_buffer_index].buffer = uniform_buffers[uniform_buffer_index]->buffers[image_index];
-                    buffer_info[image_index * uniform_buffer_count + uniform_buffer_index].offset = 0;
-                    buffer_info[image_index * uniform_buffer_count + uniform_buffer_index].range = uniform_buffers[uniform_buffer_index]->size_;
-                }
-
-                VkWriteDescriptorSet write_descriptor_set{};
-                write_descriptor_set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-                write_descriptor_set.dstSet = descriptor_set->descriptor_sets[image_index];
-                write_descriptor_set.dstBinding = 0;
-                write_descriptor_set.dstArrayElement = 0;
-                write_descriptor_set.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-                write_descriptor_set.descriptorCount = uniform_buffer_count;
-                write_descriptor_set.pBufferInfo = buffer_info + (image_index * uniform_buffer_count);
-                descriptor_writes.push_back(write_descriptor_set);
+                WriteDescriptorSet(descriptor_set, descriptor_set->descriptor_sets[image_index].set, {});
             }
-
-            vkUpdateDescriptorSets(device_, static_cast<uint32_t>(descriptor_writes.size()), descriptor_writes.data(), 0, nullptr);
-
-            delete[] buffer_info;
         }
 
         return descriptor_set;
     }
 
     void DestroyDescriptorSet(std::shared_ptr<DescriptorSet>& descriptor_set) {
-        vkDestroyDescriptorPool(device_, descriptor_set->descriptor_pool, nullptr);
-        vkDestroyDescriptorSetLayout(device_, descriptor_set->descriptor_set_layout, nullptr);
+        for (auto& allocation : descriptor_set->descriptor_sets) {
+            descriptor_allocator_.Free(allocation);
+        }
         descriptor_set.reset();
     }
 
     void UpdateDescriptorSet(std::shared_ptr<DescriptorSet>& descriptor_set, uint32_t image_index, std::vector<TextureSampler> textures) {
-        std::vector<VkWriteDescriptorSet> descriptor_writes = {};
+        WriteDescriptorSet(descriptor_set, descriptor_set->descriptor_sets[image_index].set, textures);
+    }
 
-        uint32_t binding = 0;
+    void UpdateDescriptorSets(std::shared_ptr<DescriptorSet>& descriptor_set, std::vector<TextureSampler> textures) {
+        for (uint32_t image_index = 0; image_index < image_count_; image_index++) {
+            UpdateDescriptorSet(descriptor_set, image_index, textures);
+        }
+    }
 
-        uint32_t uniform_buffer_count = static_cast<uint32_t>(descriptor_set->uniform_buffers.size());
-        VkDescriptorBufferInfo* buffer_info = new VkDescriptorBufferInfo[uniform_buffer_count];
+    // Allocates a set with the layout of descriptor_set that is only valid until this frame slot comes
+    // around again, for per-object textures that change every frame.
+    VkDescriptorSet CreateTransientDescriptorSet(std::shared_ptr<DescriptorSet>& descriptor_set, const std::vector<TextureSampler>& textures) {
+        VkDescriptorSet transient_set = frames_[current_frame_].transient_descriptor_allocator->Allocate(descriptor_set->descriptor_set_layout).set;
+        WriteDescriptorSet(descriptor_set, transient_set, textures);
+        return transient_set;
+    }
 
-        for (uint32_t uniform_buffer_index = 0; uniform_buffer_index < uniform_buffer_count; uniform_buffer_index++) {
-            buffer_info[uniform_buffer_index].buffer = descriptor_set->uniform_buffers[uniform_buffer_index]->buffers[image_index];
-            buffer_info[uniform_buffer_index].offset = 0;
-            buffer_info[uniform_buffer_index].range = descriptor_set->uniform_buffers[uniform_buffer_index]->size_;
-        }
+    bool IsBindlessSupported() {
+        return bindless_supported_;
+    }
 
-        VkWriteDescriptorSet write_descriptor_set{};
-        write_descriptor_set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        write_descriptor_set.dstSet = descriptor_set->descriptor_sets[image_index];
-        write_descriptor_set.dstBinding = binding;
-        write_descriptor_set.dstArrayElement = 0;
-        write_descriptor_set.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        write_descriptor_set.descriptorCount = uniform_buffer_count;
-        write_descriptor_set.pBufferInfo = buffer_info;
+    uint32_t RegisterBindlessTexture(TextureSampler& texture_sampler) {
+        if (!bindless_supported_) {
+            throw std::runtime_error("bindless textures are not supported on this device");
+        }
+        if (texture_sampler.bindless_index_ != UINT32_MAX) {
+            return texture_sampler.bindless_index_;
+        }
 
-        if (uniform_buffer_count > 0) {
-            descriptor_writes.push_back(write_descriptor_set);
-            binding++;
+        uint32_t index;
+        if (!bindless_free_indices_.empty()) {
+            index = bindless_free_indices_.back();
+            bindless_free_indices_.pop_back();
+        } else if (bindless_next_index_ < bindless_texture_capacity_) {
+            index = bindless_next_index_++;
+        } else {
+            throw std::runtime_error("bindless texture table is full");
         }
 
-        uint32_t image_sampler_count = static_cast<uint32_t>(descriptor_set->image_sampler_count);
-        VkDescriptorImageInfo* descriptor_images = new VkDescriptorImageInfo[image_sampler_count];
+        VkDescriptorImageInfo image_info = {};
+        image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        image_info.imageView = texture_sampler.texture_image_view_;
 
-        for (uint32_t index = 0; index < image_sampler_count; index++) {
-            descriptor_images[index] = {};
-            descriptor_images[index].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            descriptor_images[index].imageView = textures[index].texture_image_view_;
-            descriptor_images[index].sampler = textures[index].texture_sampler_;
+        VkWriteDescriptorSet write_descriptor_set{};
+        write_descriptor_set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write_descriptor_set.dstSet = bindless_set_;
+        write_descriptor_set.dstBinding = 0;
+        write_descriptor_set.dstArrayElement = index;
+        write_descriptor_set.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        write_descriptor_set.descriptorCount = 1;
+        write_descriptor_set.pImageInfo = &image_info;
 
-            VkWriteDescriptorSet write_descriptor_set{};
-            write_descriptor_set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            write_descriptor_set.dstSet = descriptor_set->descriptor_sets[image_index];
-            write_descriptor_set.dstBinding = binding++;
-            write_descriptor_set.dstArrayElement = 0;
-            write_descriptor_set.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            write_descriptor_set.descriptorCount = 1;
-            write_descriptor_set.pImageInfo = &descriptor_images[index];
-            descriptor_writes.push_back(write_descriptor_set);
-        }
+        vkUpdateDescriptorSets(device_, 1, &write_descriptor_set, 0, nullptr);
 
-        vkUpdateDescriptorSets(device_, static_cast<uint32_t>(descriptor_writes.size()), descriptor_writes.data(), 0, nullptr);
+        texture_sampler.bindless_index_ = index;
 
-        delete[] descriptor_images;
-        delete[] buffer_info;
+        return index;
     }
 
-    void UpdateDescriptorSets(std::shared_ptr<DescriptorSet>& descriptor_set, std::vector<TextureSampler> textures) {
-        for (uint32_t image_index = 0; image_index < image_count_; image_index++) {
-            UpdateDescriptorSet(descriptor_set, image_index, textures);
+    // The slot is only recycled once no submitted frame can still sample it, so callers must have
+    // waited for the device, as scenes already do before destroying textures.
+    void UnregisterBindlessTexture(TextureSampler& texture_sampler) {
+        if (texture_sampler.bindless_index_ == UINT32_MAX) {
+            return;
         }
+        bindless_free_indices_.push_back(texture_sampler.bindless_index_);
+        texture_sampler.bindless_index_ = UINT32_MAX;
+    }
+
+    void BindBindlessTextures(VkCommandBuffer& command_buffer, std::shared_ptr<GraphicsPipeline>& graphics_pipeline) {
+        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline->pipeline_layout, 1, 1, &bindless_set_, 0, nullptr);
     }
 
     VkShaderModule CreateShaderModule(const unsigned char* byte_code, size_t byte_code_length) {
@@ -495,9 +809,15 @@ public:
         uint32_t subpass,
         bool use_depth,
         bool use_alpha,
-        bool use_dynamic_state,
-        bool use_no_culling
+        bool use_no_culling,
+        bool use_bindless = false
     ) {
+        PROFILE_FUNCTION();
+
+        if (use_bindless && !bindless_supported_) {
+            throw std::runtime_error("bindless textures are not supported on this device");
+        }
+
         std::shared_ptr<GraphicsPipeline> graphics_pipeline = std::make_shared<GraphicsPipeline>();
         render_pass->graphics_pipelines_.push_back(graphics_pipeline);
 
@@ -507,9 +827,6 @@ public:
         byte_code = Utility::ReadFile(fragment_shader_module);
         graphics_pipeline->fragment_shader_module = CreateShaderModule(byte_code.data(), byte_code.size());
 
-        CreateRenderPass(static_cast<uint32_t>(render_pass->graphics_pipelines_.size()), render_pass->render_pass_);
-        CreateFramebuffers(render_pass->render_pass_, render_pass->framebuffers_);
-
         graphics_pipeline->push_constants = push_constants;
         graphics_pipeline->binding_description = binding_description;
         graphics_pipeline->attribute_descriptions = attribute_descriptions;
@@ -517,10 +834,24 @@ public:
         graphics_pipeline->subpass = subpass;
         graphics_pipeline->use_depth = use_depth;
         graphics_pipeline->use_alpha = use_alpha;
-        graphics_pipeline->use_dynamic_state = use_dynamic_state;
         graphics_pipeline->use_no_culling = use_no_culling;
+        graphics_pipeline->use_bindless = use_bindless;
 
-        RebuildGraphicsPipeline(render_pass, graphics_pipeline);
+        if (subpass + 1 > render_pass->subpass_count_) {
+            // A render pass with a different subpass count is incompatible, so earlier pipelines follow it.
+            for (auto& other : render_pass->graphics_pipelines_) {
+                if (other != graphics_pipeline) {
+                    ResetGraphicsPipeline(other);
+                }
+            }
+            render_pass->subpass_count_ = subpass + 1;
+            AcquireRenderPass(render_pass);
+            for (auto& other : render_pass->graphics_pipelines_) {
+                RebuildGraphicsPipeline(render_pass, other);
+            }
+        } else {
+            RebuildGraphicsPipeline(render_pass, graphics_pipeline);
+        }
 
         return graphics_pipeline;
     }
@@ -542,25 +873,19 @@ public:
     void CreateAlphaTexture(unsigned char* pixels, int texWidth, int texHeight, TextureSampler& texture_sampler) {
         VkDeviceSize image_size = static_cast<VkDeviceSize>(texWidth) * texHeight;
 
-        VkBuffer staging_buffer;
-        VkDeviceMemory staging_buffer_memory;
-        CreateBuffer(image_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_buffer, staging_buffer_memory);
+        StagingBuffer staging_buffer = AcquireStagingBuffer(image_size);
 
-        void* data;
-        vkMapMemory(device_, staging_buffer_memory, 0, image_size, 0, &data);
-        memcpy(data, pixels, static_cast<size_t>(image_size));
-        vkUnmapMemory(device_, staging_buffer_memory);
+        memcpy(staging_buffer.mapped, pixels, static_cast<size_t>(image_size));
 
         CreateImage(texWidth, texHeight, 1, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture_sampler.texture_image_, texture_sampler.texture_image_memory_);
 
         TransformImageLayout(texture_sampler.texture_image_, VK_FORMAT_R8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1);
-        CopyBufferToImage(staging_buffer, texture_sampler.texture_image_, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-
-        vkDestroyBuffer(device_, staging_buffer, nullptr);
-        vkFreeMemory(device_, staging_buffer_memory, nullptr);
+        CopyBufferToImage(staging_buffer.buffer, staging_buffer.offset, texture_sampler.texture_image_, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
 
         GenerateMipmaps(texture_sampler.texture_image_, VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, 1);
 
+        texture_sampler.upload_ticket_ = ReleaseStagingBuffer(staging_buffer);
+
         texture_sampler.texture_image_view_ = CreateImageView(texture_sampler.texture_image_, VK_FORMAT_R8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, 1);
 
         VkSamplerCreateInfo sampler_info = {};
@@ -587,63 +912,60 @@ public:
     }
 
     void DestroyTexture(TextureSampler& texture_sampler) {
+        UnregisterBindlessTexture(texture_sampler);
         vkDestroySampler(device_, texture_sampler.texture_sampler_, nullptr);
         vkDestroyImageView(device_, texture_sampler.texture_image_view_, nullptr);
         vkDestroyImage(device_, texture_sampler.texture_image_, nullptr);
-        vkFreeMemory(device_, texture_sampler.texture_image_memory_, nullptr);
+        allocator_.Free(texture_sampler.texture_image_memory_);
     }
 
     template <class Vertex, class Index>
     void CreateIndexedPrimitive(std::vector<Vertex>& vertices, std::vector<Index>& indices, IndexedPrimitive& primitive) {
-        VkDeviceSize bufferSize = vertices.size() * sizeof(vertices[0]);
+        CreateIndexedPrimitive(vertices.data(), vertices.size(), indices.data(), indices.size(), primitive);
+    }
+
+    // Takes plain pointers so data mapped straight from a file can be copied into the staging buffer.
+    template <class Vertex, class Index>
+    void CreateIndexedPrimitive(const Vertex* vertices, size_t vertices_count, const Index* indices, size_t indices_count, IndexedPrimitive& primitive) {
+        VkDeviceSize bufferSize = vertices_count * sizeof(vertices[0]);
 
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+        StagingBuffer stagingBuffer = AcquireStagingBuffer(bufferSize);
 
-        void* data;
-        vkMapMemory(device_, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, vertices.data(), (size_t)bufferSize);
-        vkUnmapMemory(device_, stagingBufferMemory);
+        memcpy(stagingBuffer.mapped, vertices, (size_t)bufferSize);
 
         CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, primitive.vertex_buffer_, primitive.vertex_buffer_memory_);
 
-        CopyBuffer(stagingBuffer, primitive.vertex_buffer_, bufferSize);
+        CopyBuffer(stagingBuffer.buffer, stagingBuffer.offset, primitive.vertex_buffer_, bufferSize);
 
-        vkDestroyBuffer(device_, stagingBuffer, nullptr);
-        vkFreeMemory(device_, stagingBufferMemory, nullptr);
+        ReleaseStagingBuffer(stagingBuffer);
 
-        primitive.index_count_ = static_cast<uint32_t>(indices.size());
+        primitive.index_count_ = static_cast<uint32_t>(indices_count);
 
-        bufferSize = indices.size() * sizeof(indices[0]);
+        bufferSize = indices_count * sizeof(indices[0]);
 
-        CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+        stagingBuffer = AcquireStagingBuffer(bufferSize);
 
-        vkMapMemory(device_, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, indices.data(), (size_t)bufferSize);
-        vkUnmapMemory(device_, stagingBufferMemory);
+        memcpy(stagingBuffer.mapped, indices, (size_t)bufferSize);
 
         CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, primitive.index_buffer_, primitive.index_buffer_memory_);
 
-        CopyBuffer(stagingBuffer, primitive.index_buffer_, bufferSize);
+        CopyBuffer(stagingBuffer.buffer, stagingBuffer.offset, primitive.index_buffer_, bufferSize);
 
-        vkDestroyBuffer(device_, stagingBuffer, nullptr);
-        vkFreeMemory(device_, stagingBufferMemory, nullptr);
+        primitive.upload_ticket_ = ReleaseStagingBuffer(stagingBuffer);
     }
 
     void CreateOrResizeBuffer(VkDeviceSize size, VkBufferUsageFlags flags, Buffer& buffer) {
         if (buffer.buffer != VK_NULL_HANDLE) {
             vkDestroyBuffer(device_, buffer.buffer, nullptr);
         }
-        if (buffer.memory != VK_NULL_HANDLE) {
-            vkFreeMemory(device_, buffer.memory, nullptr);
-        }
+        allocator_.Free(buffer.memory);
         CreateBuffer(size, flags, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer.buffer, buffer.memory);
+        buffer.size = size;
     }
 
     void DestroyBuffer(Buffer& buffer) {
         vkDestroyBuffer(device_, buffer.buffer, nullptr);
-        vkFreeMemory(device_, buffer.memory, nullptr);
+        allocator_.Free(buffer.memory);
     }
 
     template <class Vertex, class Index>
@@ -656,55 +978,184 @@ public:
     void UpdateDynamicIndexedPrimitive(Vertex* vertices, uint32_t vertices_count, Index* indices, uint32_t indices_count, IndexedPrimitive& primitive) {
         VkDeviceSize bufferSize = vertices_count * sizeof(vertices[0]);
 
-        void* data;
-        vkMapMemory(device_, primitive.vertex_buffer_memory_, 0, bufferSize, 0, &data);
-        memcpy(data, vertices, (size_t)bufferSize);
-        vkUnmapMemory(device_, primitive.vertex_buffer_memory_);
+        memcpy(primitive.vertex_buffer_memory_.mapped, vertices, (size_t)bufferSize);
 
         primitive.index_count_ = indices_count;
 
         bufferSize = indices_count * sizeof(indices[0]);
 
-        vkMapMemory(device_, primitive.index_buffer_memory_, 0, bufferSize, 0, &data);
-        memcpy(data, indices, (size_t)bufferSize);
-        vkUnmapMemory(device_, primitive.index_buffer_memory_);
+        memcpy(primitive.index_buffer_memory_.mapped, indices, (size_t)bufferSize);
     }
 
     void DestroyIndexedPrimitive(IndexedPrimitive& primitive) {
         vkDestroyBuffer(device_, primitive.index_buffer_, nullptr);
-        vkFreeMemory(device_, primitive.index_buffer_memory_, nullptr);
+        allocator_.Free(primitive.index_buffer_memory_);
         vkDestroyBuffer(device_, primitive.vertex_buffer_, nullptr);
-        vkFreeMemory(device_, primitive.vertex_buffer_memory_, nullptr);
+        allocator_.Free(primitive.vertex_buffer_memory_);
     }
 
-private:
-    uint32_t max_frames_in_flight_{2};
-    RenderApplication* render_application_{};
-    bool debug_layers_ = false;
+    MemoryAllocator::Statistics GetMemoryStatistics() {
+        return allocator_.GetStatistics();
+    }
 
-    VkSurfaceKHR surface_ = nullptr;
-    uint32_t graphics_family_index_ = 0;
-    uint32_t present_family_index_ = 0;
-    VkQueue graphics_queue_ = nullptr;
-    VkQueue present_queue_ = nullptr;
-    VkCommandPool command_pool_ = nullptr;
-    VkSurfaceCapabilitiesKHR capabilities_{};
-    VkSurfaceFormatKHR surface_format_{};
-    VkFormat depth_format_ = VK_FORMAT_UNDEFINED;
-    VkPresentModeKHR present_mode_ = VK_PRESENT_MODE_IMMEDIATE_KHR;
+    std::string GetDeviceName() {
+        return physical_device_properties_.deviceName;
+    }
 
-    VkInstance instance_{};
-    std::vector<VkSemaphore> image_available_semaphores_;
-    std::vector<VkSemaphore> render_finished_semaphores_;
-    std::vector<VkFence> in_flight_fences_;
-    std::vector<VkFence> images_in_flight_;
-    size_t current_frame_ = 0;
+    // Uploads are recorded into the open batch and submitted ahead of the next draw submission, so a
+    // resource may be drawn as soon as its creation call returns. The ticket only reports when the
+    // copy has finished on the GPU.
+    bool IsUploadComplete(uint64_t upload_ticket) {
+        std::lock_guard<std::mutex> lock(upload_mutex_);
+        ReclaimUploadBatches();
+        return upload_ticket <= completed_upload_ticket_;
+    }
 
-    VkDebugUtilsMessengerEXT debug_messenger_;
+    void FlushUploads() {
+        std::lock_guard<std::mutex> lock(upload_mutex_);
 
-    VkPhysicalDevice physical_device_ = VK_NULL_HANDLE;
-    VkPhysicalDeviceProperties physical_device_properties_{};
-    const std::vector<const char*> device_extensions_{VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+        UploadBatch& batch = upload_batches_[upload_batch_index_];
+
+        if (!batch.recording) {
+            return;
+        }
+
+        VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+        VkSubmitInfo submit_info = {};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+
+        if (batch.transfer_recording) {
+            vkEndCommandBuffer(batch.transfer_command_buffer);
+
+            submit_info.commandBufferCount = 1;
+            submit_info.pCommandBuffers = &batch.transfer_command_buffer;
+            submit_info.signalSemaphoreCount = 1;
+            submit_info.pSignalSemaphores = &batch.transfer_semaphore;
+
+            if (vkQueueSubmit(transfer_queue_, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS) {
+                throw std::runtime_error("failed to submit transfer command buffer");
+            }
+
+            submit_info = {};
+            submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submit_info.waitSemaphoreCount = 1;
+            submit_info.pWaitSemaphores = &batch.transfer_semaphore;
+            submit_info.pWaitDstStageMask = &wait_stage;
+        }
+
+        vkEndCommandBuffer(batch.graphics_command_buffer);
+
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &batch.graphics_command_buffer;
+
+        if (vkQueueSubmit(graphics_queue_, 1, &submit_info, batch.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit upload command buffer");
+        }
+
+        batch.recording = false;
+        batch.transfer_recording = false;
+        batch.submitted = true;
+
+        upload_batch_index_ = (upload_batch_index_ + 1) % upload_batches_.size();
+        next_upload_ticket_++;
+    }
+
+private:
+    uint32_t max_frames_in_flight_{2};
+    static const uint32_t max_uniform_buffers_per_set_ = 8;
+    static const uint32_t max_image_samplers_per_set_ = 8;
+    static const uint32_t max_bindless_textures_ = 4096;
+
+    DescriptorAllocator descriptor_allocator_{};
+    DescriptorLayoutCache descriptor_layout_cache_{};
+
+    uint32_t instance_api_version_ = VK_API_VERSION_1_0;
+    bool bindless_supported_{};
+    uint32_t bindless_texture_capacity_{};
+    uint32_t bindless_next_index_{};
+    std::vector<uint32_t> bindless_free_indices_{};
+    std::array<VkSampler, bindless_sampler_count> bindless_samplers_{};
+    VkDescriptorSetLayout bindless_set_layout_{};
+    VkDescriptorPool bindless_pool_{};
+    VkDescriptorSet bindless_set_{};
+    const VkDeviceSize uniform_arena_frame_size_ = 1024 * 1024;
+    RenderApplication* render_application_{};
+    bool headless_{};
+    VkExtent2D headless_extent_{};
+    std::vector<Allocation> headless_image_memory_{};
+    bool debug_layers_ = false;
+
+    VkSurfaceKHR surface_ = nullptr;
+    uint32_t graphics_family_index_ = 0;
+    uint32_t present_family_index_ = 0;
+    uint32_t transfer_family_index_ = 0;
+    VkQueue graphics_queue_ = nullptr;
+    VkQueue present_queue_ = nullptr;
+    VkQueue transfer_queue_ = nullptr;
+    VkSurfaceCapabilitiesKHR capabilities_{};
+    VkSurfaceFormatKHR surface_format_{};
+    VkFormat depth_format_ = VK_FORMAT_UNDEFINED;
+    VkPresentModeKHR present_mode_ = VK_PRESENT_MODE_IMMEDIATE_KHR;
+    VkPresentModeKHR requested_present_mode_ = VK_PRESENT_MODE_FIFO_KHR;
+
+    VkInstance instance_{};
+    // Everything the CPU writes while recording a frame, so recording frame N + 1 never waits on the
+    // GPU still executing frame N.
+    // Command pools are externally synchronized, so every recording thread gets its own.
+    struct SecondaryCommandPool {
+        VkCommandPool command_pool{};
+        std::vector<VkCommandBuffer> command_buffers{};
+        uint32_t used{};
+    };
+
+    struct FrameContext {
+        VkCommandPool command_pool{};
+        VkCommandBuffer command_buffer{};
+        VkSemaphore image_available_semaphore{};
+        VkSemaphore render_finished_semaphore{};
+        VkFence in_flight_fence{};
+        std::unique_ptr<DescriptorAllocator> transient_descriptor_allocator{};
+        std::vector<SecondaryCommandPool> secondary_command_pools{};
+        VkCommandBuffer capture_command_buffer{};
+        VkCommandBuffer profiler_command_buffer{};
+        VkCommandBuffer overlay_command_buffer{};
+        uint32_t capture_buffer{UINT32_MAX};
+        uint64_t capture_frame_number{};
+    };
+
+    static const uint32_t max_supported_frames_in_flight_ = 4;
+    std::vector<FrameContext> frames_{};
+    size_t current_frame_ = 0;
+
+    JobSystem job_system_{};
+    GpuProfiler gpu_profiler_{};
+    std::atomic<uint32_t> draw_calls_{};
+
+    FrameStatistics frame_statistics_{};
+    std::chrono::steady_clock::time_point frame_start_time_{};
+    float acquire_wait_ms_{};
+    float present_wait_ms_{};
+    std::function<void(VkCommandBuffer&, uint32_t)> overlay_{};
+
+    // Leaves room for the encoder to fall a few frames behind before captures are dropped.
+    static const uint32_t capture_buffers_beyond_frames_ = 3;
+    bool capturing_{};
+    FrameCapture frame_capture_{};
+    std::vector<Buffer> capture_buffers_{};
+    std::vector<uint32_t> free_capture_buffers_{};
+    std::mutex capture_mutex_{};
+    uint64_t capture_frame_number_{};
+    uint32_t captures_dropped_{};
+
+    VkDebugUtilsMessengerEXT debug_messenger_;
+
+    VkPhysicalDevice physical_device_ = VK_NULL_HANDLE;
+    MemoryAllocator allocator_{};
+    VkPhysicalDeviceProperties physical_device_properties_{};
+    VkPipelineCache pipeline_cache_{};
+    const char* pipeline_cache_file_ = "pipeline_cache.bin";
+    std::vector<const char*> device_extensions_{VK_KHR_SWAPCHAIN_EXTENSION_NAME};
     const std::vector<const char*> validation_layers_{"VK_LAYER_KHRONOS_validation"};
 
     VkSampleCountFlagBits msaa_samples_ = VK_SAMPLE_COUNT_1_BIT;
@@ -715,14 +1166,88 @@ private:
     std::vector<VkImageView> swapchain_image_views_{};
 
     VkImage color_image_{};
-    VkDeviceMemory color_image_memory_{};
+    Allocation color_image_memory_{};
     VkImageView color_image_view_{};
 
     VkImage depth_image_{};
-    VkDeviceMemory depth_image_memory_{};
+    Allocation depth_image_memory_{};
     VkImageView depth_image_view_{};
 
+    struct RenderPassKey {
+        VkFormat color_format{};
+        VkFormat depth_format{};
+        VkSampleCountFlagBits samples{};
+        VkAttachmentLoadOp color_load_op{};
+        VkAttachmentStoreOp color_store_op{};
+        VkAttachmentLoadOp depth_load_op{};
+        VkAttachmentStoreOp depth_store_op{};
+        uint32_t subpass_count{};
+
+        bool operator<(const RenderPassKey& other) const {
+            return std::tie(color_format, depth_format, samples, color_load_op, color_store_op, depth_load_op, depth_store_op, subpass_count) <
+                   std::tie(other.color_format, other.depth_format, other.samples, other.color_load_op, other.color_store_op, other.depth_load_op, other.depth_store_op, other.subpass_count);
+        }
+    };
+
+    struct FramebufferKey {
+        VkRenderPass render_pass{};
+        std::array<VkImageView, 3> attachments{};
+        uint32_t width{};
+        uint32_t height{};
+
+        bool operator<(const FramebufferKey& other) const {
+            return std::tie(render_pass, attachments, width, height) < std::tie(other.render_pass, other.attachments, other.width, other.height);
+        }
+    };
+
     std::vector<std::shared_ptr<RenderPass>> render_passes_{};
+    std::map<RenderPassKey, VkRenderPass> render_pass_cache_{};
+    std::map<FramebufferKey, VkFramebuffer> framebuffer_cache_{};
+
+    VkBuffer uniform_arena_buffer_{};
+    Allocation uniform_arena_memory_{};
+    VkDeviceSize uniform_arena_head_{};
+
+    struct UploadBatch {
+        VkCommandBuffer graphics_command_buffer{};
+        VkCommandBuffer transfer_command_buffer{};
+        VkSemaphore transfer_semaphore{};
+        VkFence fence{};
+        uint64_t ticket{};
+        bool recording{};
+        bool transfer_recording{};
+        bool submitted{};
+        std::vector<std::pair<VkBuffer, Allocation>> staging_buffers{};
+    };
+
+    struct StagingBuffer {
+        VkBuffer buffer{};
+        VkDeviceSize offset{};
+        void* mapped{};
+        Allocation memory{};
+        uint64_t ring_range{};
+    };
+
+    struct StagingRange {
+        VkDeviceSize end{};
+        uint64_t ticket{};
+    };
+
+    std::array<UploadBatch, 3> upload_batches_{};
+    size_t upload_batch_index_{};
+    uint64_t next_upload_ticket_{1};
+    uint64_t completed_upload_ticket_{};
+    VkCommandPool upload_command_pool_{};
+    VkCommandPool transfer_command_pool_{};
+    std::mutex upload_mutex_{};
+
+    const VkDeviceSize staging_ring_size_ = 32 * 1024 * 1024;
+    VkBuffer staging_ring_buffer_{};
+    Allocation staging_ring_memory_{};
+    VkDeviceSize staging_ring_head_{};
+    VkDeviceSize staging_ring_tail_{};
+    std::deque<StagingRange> staging_ranges_{};
+    uint64_t staging_first_range_{};
 
     void CreateInstance(std::vector<const char*>& required_extensions) {
         if (debug_layers_) {
@@ -737,7 +1262,11 @@ private:
         application_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         application_info.pEngineName = "No Engine";
         application_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        application_info.apiVersion = VK_API_VERSION_1_0;
+        auto enumerate_instance_version = (PFN_vkEnumerateInstanceVersion)vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion");
+        if (enumerate_instance_version != nullptr) {
+            enumerate_instance_version(&instance_api_version_);
+        }
+        application_info.apiVersion = instance_api_version_ >= VK_API_VERSION_1_2 ? VK_API_VERSION_1_2 : VK_API_VERSION_1_0;
 
         VkInstanceCreateInfo create_info = {};
         create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -861,8 +1390,8 @@ private:
 
         bool extensions_supported = CheckDeviceExtensionSupport(physical_device);
 
-        bool swap_chain_adequate = false;
-        if (extensions_supported) {
+        bool swap_chain_adequate = headless_;
+        if (extensions_supported && !headless_) {
             VkSurfaceCapabilitiesKHR capabilities;
             std::vector<VkSurfaceFormatKHR> formats;
             std::vector<VkPresentModeKHR> presentModes;
@@ -893,6 +1422,14 @@ private:
         std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
         vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &queue_family_count, queue_families.data());
 
+        transfer_family_index_ = -1;
+        for (uint32_t index = 0; index < queue_family_count; index++) {
+            if ((queue_families[index].queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queue_families[index].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+                transfer_family_index_ = index;
+                break;
+            }
+        }
+
         graphics_family_index_ = -1;
         present_family_index_ = -1;
         int index = 0;
@@ -902,13 +1439,20 @@ private:
             }
 
             VkBool32 present_support = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(physical_device, index, surface_, &present_support);
+            if (headless_) {
+                present_support = (queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+            } else {
+                vkGetPhysicalDeviceSurfaceSupportKHR(physical_device, index, surface_, &present_support);
+            }
 
             if (present_support) {
                 present_family_index_ = index;
             }
 
             if (graphics_family_index_ != -1 && present_family_index_ != -1) {
+                if (transfer_family_index_ == -1) {
+                    transfer_family_index_ = graphics_family_index_;
+                }
                 return true;
             }
 
@@ -957,7 +1501,7 @@ private:
 
     void CreateLogicalDevice() {
         std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
-        std::set<uint32_t> unique_queue_families = {graphics_family_index_, present_family_index_};
+        std::set<uint32_t> unique_queue_families = {graphics_family_index_, present_family_index_, transfer_family_index_};
 
         float queuePriority = 1.0f;
         for (uint32_t queue_family : unique_queue_families) {
@@ -972,8 +1516,38 @@ private:
         VkPhysicalDeviceFeatures device_features = {};
         device_features.samplerAnisotropy = VK_TRUE;
 
+        VkPhysicalDeviceVulkan12Features vulkan12_features = {};
+        vulkan12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+        bindless_supported_ = false;
+        if (instance_api_version_ >= VK_API_VERSION_1_2 && physical_device_properties_.apiVersion >= VK_API_VERSION_1_2) {
+            VkPhysicalDeviceFeatures2 features2 = {};
+            features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            features2.pNext = &vulkan12_features;
+            vkGetPhysicalDeviceFeatures2(physical_device_, &features2);
+
+            bindless_supported_ = vulkan12_features.descriptorIndexing && vulkan12_features.runtimeDescriptorArray &&
+                                  vulkan12_features.descriptorBindingPartiallyBound && vulkan12_features.descriptorBindingSampledImageUpdateAfterBind &&
+                                  vulkan12_features.shaderSampledImageArrayNonUniformIndexing;
+
+            VkPhysicalDeviceVulkan12Features supported = vulkan12_features;
+            vulkan12_features = {};
+            vulkan12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+            if (bindless_supported_) {
+                vulkan12_features.descriptorIndexing = VK_TRUE;
+                vulkan12_features.runtimeDescriptorArray = VK_TRUE;
+                vulkan12_features.descriptorBindingPartiallyBound = VK_TRUE;
+                vulkan12_features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+                vulkan12_features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+                vulkan12_features.descriptorBindingUpdateUnusedWhilePending = supported.descriptorBindingUpdateUnusedWhilePending;
+            }
+        }
+
         VkDeviceCreateInfo create_info = {};
         create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        if (physical_device_properties_.apiVersion >= VK_API_VERSION_1_2 && instance_api_version_ >= VK_API_VERSION_1_2) {
+            create_info.pNext = &vulkan12_features;
+        }
 
         create_info.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size());
         create_info.pQueueCreateInfos = queue_create_infos.data();
@@ -996,42 +1570,265 @@ private:
 
         vkGetDeviceQueue(device_, graphics_family_index_, 0, &graphics_queue_);
         vkGetDeviceQueue(device_, present_family_index_, 0, &present_queue_);
+        vkGetDeviceQueue(device_, transfer_family_index_, 0, &transfer_queue_);
     }
 
-    void CreateCommandPool() {
+    void CreateUploadBatches() {
         VkCommandPoolCreateInfo pool_info = {};
         pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
         pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
         pool_info.queueFamilyIndex = graphics_family_index_;
 
-        if (vkCreateCommandPool(device_, &pool_info, nullptr, &command_pool_) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create command pool");
+        if (vkCreateCommandPool(device_, &pool_info, nullptr, &upload_command_pool_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create upload command pool");
+        }
+
+        if (transfer_family_index_ != graphics_family_index_) {
+            pool_info.queueFamilyIndex = transfer_family_index_;
+
+            if (vkCreateCommandPool(device_, &pool_info, nullptr, &transfer_command_pool_) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create transfer command pool");
+            }
+        }
+
+        VkSemaphoreCreateInfo semaphore_info = {};
+        semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+        VkFenceCreateInfo fence_info = {};
+        fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        for (auto& batch : upload_batches_) {
+            VkCommandBufferAllocateInfo allocate_info = {};
+            allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocate_info.commandPool = upload_command_pool_;
+            allocate_info.commandBufferCount = 1;
+
+            if (vkAllocateCommandBuffers(device_, &allocate_info, &batch.graphics_command_buffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate upload command buffer");
+            }
+
+            if (transfer_command_pool_ != VK_NULL_HANDLE) {
+                allocate_info.commandPool = transfer_command_pool_;
+
+                if (vkAllocateCommandBuffers(device_, &allocate_info, &batch.transfer_command_buffer) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to allocate transfer command buffer");
+                }
+            }
+
+            if (vkCreateSemaphore(device_, &semaphore_info, nullptr, &batch.transfer_semaphore) != VK_SUCCESS ||
+                vkCreateFence(device_, &fence_info, nullptr, &batch.fence) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create synchronization objects for an upload batch");
+            }
         }
+
+        CreateBuffer(staging_ring_size_, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_ring_buffer_, staging_ring_memory_);
+    }
+
+    void DestroyUploadBatches() {
+        for (auto& batch : upload_batches_) {
+            if (batch.submitted) {
+                vkWaitForFences(device_, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+            }
+            for (auto& staging_buffer : batch.staging_buffers) {
+                vkDestroyBuffer(device_, staging_buffer.first, nullptr);
+                allocator_.Free(staging_buffer.second);
+            }
+            batch.staging_buffers.clear();
+            vkDestroySemaphore(device_, batch.transfer_semaphore, nullptr);
+            vkDestroyFence(device_, batch.fence, nullptr);
+        }
+        if (transfer_command_pool_ != VK_NULL_HANDLE) {
+            vkDestroyCommandPool(device_, transfer_command_pool_, nullptr);
+        }
+        vkDestroyCommandPool(device_, upload_command_pool_, nullptr);
+
+        vkDestroyBuffer(device_, staging_ring_buffer_, nullptr);
+        allocator_.Free(staging_ring_memory_);
+        staging_ranges_.clear();
+    }
+
+    // Must be called with upload_mutex_ held.
+    void ReclaimUploadBatches() {
+        for (auto& batch : upload_batches_) {
+            if (!batch.submitted || vkGetFenceStatus(device_, batch.fence) != VK_SUCCESS) {
+                continue;
+            }
+            for (auto& staging_buffer : batch.staging_buffers) {
+                vkDestroyBuffer(device_, staging_buffer.first, nullptr);
+                allocator_.Free(staging_buffer.second);
+            }
+            batch.staging_buffers.clear();
+            batch.submitted = false;
+            completed_upload_ticket_ = std::max(completed_upload_ticket_, batch.ticket);
+        }
+
+        // Ring ranges are retired in allocation order, so a range released into a later batch holds
+        // back the tail even if younger ranges have already completed.
+        while (!staging_ranges_.empty() && staging_ranges_.front().ticket != 0 && staging_ranges_.front().ticket <= completed_upload_ticket_) {
+            staging_ring_tail_ = staging_ranges_.front().end;
+            staging_ranges_.pop_front();
+            staging_first_range_++;
+        }
+    }
+
+    // Must be called with upload_mutex_ held. Returns false when no batch is in flight.
+    bool WaitForOldestUploadBatch() {
+        UploadBatch* oldest = nullptr;
+        for (auto& batch : upload_batches_) {
+            if (batch.submitted && (oldest == nullptr || batch.ticket < oldest->ticket)) {
+                oldest = &batch;
+            }
+        }
+
+        if (oldest == nullptr) {
+            return false;
+        }
+
+        vkWaitForFences(device_, 1, &oldest->fence, VK_TRUE, UINT64_MAX);
+        ReclaimUploadBatches();
+
+        return true;
+    }
+
+    // Must be called with upload_mutex_ held.
+    bool AllocateStagingRange(VkDeviceSize size, VkDeviceSize& offset) {
+        if (staging_ranges_.empty()) {
+            staging_ring_head_ = 0;
+            staging_ring_tail_ = 0;
+        }
+
+        VkDeviceSize alignment = std::max<VkDeviceSize>(limits_.optimalBufferCopyOffsetAlignment, 16);
+        VkDeviceSize aligned_offset = (staging_ring_head_ + alignment - 1) / alignment * alignment;
+
+        if (staging_ranges_.empty() || staging_ring_head_ > staging_ring_tail_) {
+            if (aligned_offset + size > staging_ring_size_) {
+                if (size > staging_ring_tail_) {
+                    return false;
+                }
+                aligned_offset = 0;
+            }
+        } else if (aligned_offset + size > staging_ring_tail_) {
+            return false;
+        }
+
+        offset = aligned_offset;
+        staging_ring_head_ = aligned_offset + size;
+        staging_ranges_.push_back({staging_ring_head_, 0});
+
+        return true;
+    }
+
+    StagingBuffer AcquireStagingBuffer(VkDeviceSize size) {
+        std::lock_guard<std::mutex> lock(upload_mutex_);
+
+        StagingBuffer staging_buffer{};
+
+        if (size <= staging_ring_size_ / 2) {
+            ReclaimUploadBatches();
+
+            VkDeviceSize offset = 0;
+            bool allocated = AllocateStagingRange(size, offset);
+            while (!allocated && WaitForOldestUploadBatch()) {
+                allocated = AllocateStagingRange(size, offset);
+            }
+
+            if (allocated) {
+                staging_buffer.buffer = staging_ring_buffer_;
+                staging_buffer.offset = offset;
+                staging_buffer.mapped = static_cast<char*>(staging_ring_memory_.mapped) + offset;
+                staging_buffer.ring_range = staging_first_range_ + staging_ranges_.size() - 1;
+                return staging_buffer;
+            }
+        }
+
+        // Oversize uploads, or ring space still held by the batch being recorded.
+        CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_buffer.buffer, staging_buffer.memory);
+        staging_buffer.mapped = staging_buffer.memory.mapped;
+
+        return staging_buffer;
+    }
+
+    // Must be called with upload_mutex_ held.
+    UploadBatch& BeginUploadBatch() {
+        UploadBatch& batch = upload_batches_[upload_batch_index_];
+
+        if (batch.recording) {
+            return batch;
+        }
+
+        if (batch.submitted) {
+            vkWaitForFences(device_, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+            ReclaimUploadBatches();
+        }
+
+        vkResetFences(device_, 1, &batch.fence);
+
+        VkCommandBufferBeginInfo begin_info = {};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        vkBeginCommandBuffer(batch.graphics_command_buffer, &begin_info);
+
+        batch.ticket = next_upload_ticket_;
+        batch.recording = true;
+
+        return batch;
+    }
+
+    // Must be called with upload_mutex_ held. Falls back to the graphics command buffer when the
+    // device has no dedicated transfer queue family.
+    VkCommandBuffer GetTransferCommandBuffer(UploadBatch& batch) {
+        if (transfer_command_pool_ == VK_NULL_HANDLE) {
+            return batch.graphics_command_buffer;
+        }
+
+        if (!batch.transfer_recording) {
+            VkCommandBufferBeginInfo begin_info = {};
+            begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+            vkBeginCommandBuffer(batch.transfer_command_buffer, &begin_info);
+
+            batch.transfer_recording = true;
+        }
+
+        return batch.transfer_command_buffer;
+    }
+
+    uint64_t ReleaseStagingBuffer(StagingBuffer& staging_buffer) {
+        std::lock_guard<std::mutex> lock(upload_mutex_);
+
+        UploadBatch& batch = BeginUploadBatch();
+
+        if (staging_buffer.memory.memory != VK_NULL_HANDLE) {
+            batch.staging_buffers.push_back({staging_buffer.buffer, staging_buffer.memory});
+        } else {
+            staging_ranges_[staging_buffer.ring_range - staging_first_range_].ticket = batch.ticket;
+        }
+
+        staging_buffer = {};
+
+        return batch.ticket;
     }
 
     void CreateTexture(unsigned char* pixels, int texWidth, int texHeight, TextureSampler& texture_sampler) {
         VkDeviceSize image_size = static_cast<VkDeviceSize>(texWidth) * texHeight * 4;
         uint32_t mip_levels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
 
-        VkBuffer staging_buffer;
-        VkDeviceMemory staging_buffer_memory;
-        CreateBuffer(image_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_buffer, staging_buffer_memory);
+        StagingBuffer staging_buffer = AcquireStagingBuffer(image_size);
 
-        void* data;
-        vkMapMemory(device_, staging_buffer_memory, 0, image_size, 0, &data);
-        memcpy(data, pixels, static_cast<size_t>(image_size));
-        vkUnmapMemory(device_, staging_buffer_memory);
+        memcpy(staging_buffer.mapped, pixels, static_cast<size_t>(image_size));
 
         CreateImage(texWidth, texHeight, mip_levels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture_sampler.texture_image_, texture_sampler.texture_image_memory_);
 
         TransformImageLayout(texture_sampler.texture_image_, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mip_levels);
-        CopyBufferToImage(staging_buffer, texture_sampler.texture_image_, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-
-        vkDestroyBuffer(device_, staging_buffer, nullptr);
-        vkFreeMemory(device_, staging_buffer_memory, nullptr);
+        CopyBufferToImage(staging_buffer.buffer, staging_buffer.offset, texture_sampler.texture_image_, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
 
         GenerateMipmaps(texture_sampler.texture_image_, VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, mip_levels);
 
+        texture_sampler.upload_ticket_ = ReleaseStagingBuffer(staging_buffer);
+
         texture_sampler.texture_image_view_ = CreateImageView(texture_sampler.texture_image_, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, mip_levels);
 
         VkSamplerCreateInfo sampler_info = {};
@@ -1058,6 +1855,8 @@ private:
     }
 
     void RebuildGraphicsPipeline(std::shared_ptr<RenderPass>& render_pass, std::shared_ptr<GraphicsPipeline>& graphics_pipeline) {
+        PROFILE_FUNCTION();
+
         VkPipelineShaderStageCreateInfo vertex_shader_stage_info = {};
         vertex_shader_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         vertex_shader_stage_info.stage = VK_SHADER_STAGE_VERTEX_BIT;
@@ -1085,24 +1884,10 @@ private:
         input_assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
         input_assembly.primitiveRestartEnable = VK_FALSE;
 
-        VkViewport viewport = {};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = (float)swapchain_extent_.width;
-        viewport.height = (float)swapchain_extent_.height;
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-
-        VkRect2D scissor = {};
-        scissor.offset = {0, 0};
-        scissor.extent = swapchain_extent_;
-
         VkPipelineViewportStateCreateInfo viewport_state = {};
         viewport_state.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
         viewport_state.viewportCount = 1;
-        viewport_state.pViewports = &viewport;
         viewport_state.scissorCount = 1;
-        viewport_state.pScissors = &scissor;
 
         VkPipelineRasterizationStateCreateInfo rasterizer = {};
         rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -1176,8 +1961,9 @@ private:
 
         VkPipelineLayoutCreateInfo pipeline_layout_info = {};
         pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipeline_layout_info.setLayoutCount = 1;
-        pipeline_layout_info.pSetLayouts = &graphics_pipeline->descriptor_set->descriptor_set_layout;
+        std::array<VkDescriptorSetLayout, 2> set_layouts = {graphics_pipeline->descriptor_set->descriptor_set_layout, bindless_set_layout_};
+        pipeline_layout_info.setLayoutCount = graphics_pipeline->use_bindless ? 2 : 1;
+        pipeline_layout_info.pSetLayouts = set_layouts.data();
         pipeline_layout_info.pushConstantRangeCount = static_cast<uint32_t>(push_constant_ranges.size());
         pipeline_layout_info.pPushConstantRanges = push_constant_ranges.data();
 
@@ -1191,12 +1977,6 @@ private:
         dynamic_state.dynamicStateCount = 2;
         dynamic_state.pDynamicStates = dynamic_states;
 
-        VkPipelineDynamicStateCreateInfo* ds{};
-
-        if (graphics_pipeline->use_dynamic_state) {
-            ds = &dynamic_state;
-        }
-
         VkGraphicsPipelineCreateInfo pipeline_info = {};
         pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
         pipeline_info.stageCount = 2;
@@ -1208,13 +1988,13 @@ private:
         pipeline_info.pMultisampleState = &multisampling;
         pipeline_info.pDepthStencilState = &depth_stencil;
         pipeline_info.pColorBlendState = &color_blending;
-        pipeline_info.pDynamicState = ds;
+        pipeline_info.pDynamicState = &dynamic_state;
         pipeline_info.layout = graphics_pipeline->pipeline_layout;
         pipeline_info.renderPass = render_pass->render_pass_;
         pipeline_info.subpass = graphics_pipeline->subpass;
         pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
 
-        if (vkCreateGraphicsPipelines(device_, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &graphics_pipeline->graphics_pipeline) != VK_SUCCESS) {
+        if (vkCreateGraphicsPipelines(device_, pipeline_cache_, 1, &pipeline_info, nullptr, &graphics_pipeline->graphics_pipeline) != VK_SUCCESS) {
             throw std::runtime_error("failed to create graphics pipeline");
         }
     }
@@ -1224,7 +2004,8 @@ private:
         vkDestroyPipelineLayout(device_, graphics_pipeline->pipeline_layout, nullptr);
     }
 
-    void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& buffer_memory) {
+    // preferred_properties are added to properties when a memory type the buffer can use has them all.
+    void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& buffer_memory, VkMemoryPropertyFlags preferred_properties = 0) {
         VkBufferCreateInfo buffer_info = {};
         buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         buffer_info.size = size;
@@ -1238,29 +2019,13 @@ private:
         VkMemoryRequirements memory_requirements;
         vkGetBufferMemoryRequirements(device_, buffer, &memory_requirements);
 
-        VkMemoryAllocateInfo allocate_info = {};
-        allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocate_info.allocationSize = memory_requirements.size;
-        allocate_info.memoryTypeIndex = FindMemoryType(memory_requirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(device_, &allocate_info, nullptr, &buffer_memory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate buffer memory");
+        if (preferred_properties != 0 && allocator_.HasMemoryType(memory_requirements.memoryTypeBits, properties | preferred_properties)) {
+            properties |= preferred_properties;
         }
 
-        vkBindBufferMemory(device_, buffer, buffer_memory, 0);
-    }
-
-    uint32_t FindMemoryType(uint32_t type_filter, VkMemoryPropertyFlags properties) {
-        VkPhysicalDeviceMemoryProperties memory_properties;
-        vkGetPhysicalDeviceMemoryProperties(physical_device_, &memory_properties);
-
-        for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++) {
-            if ((type_filter & (1 << i)) && (memory_properties.memoryTypes[i].propertyFlags & properties) == properties) {
-                return i;
-            }
-        }
+        buffer_memory = allocator_.Allocate(memory_requirements, properties, true);
 
-        throw std::runtime_error("unable to find required memory type");
+        vkBindBufferMemory(device_, buffer, buffer_memory.memory, buffer_memory.offset);
     }
 
     VkSurfaceFormatKHR ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& available_formats) {
@@ -1274,11 +2039,11 @@ private:
     }
 
     VkPresentModeKHR ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& available_present_modes) {
-        //for (const auto& available_present_mode : available_present_modes) {
-        //    if (available_present_mode == VK_PRESENT_MODE_MAILBOX_KHR) {
-        //        return available_present_mode;
-        //    }
-        //}
+        for (const auto& available_present_mode : available_present_modes) {
+            if (available_present_mode == requested_present_mode_) {
+                return available_present_mode;
+            }
+        }
 
         return VK_PRESENT_MODE_FIFO_KHR;
     }
@@ -1306,31 +2071,79 @@ private:
         throw std::runtime_error("failed to find supported format");
     }
 
-    void CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-        VkCommandBuffer commandBuffer = BeginCommands();
+    void CopyBuffer(VkBuffer srcBuffer, VkDeviceSize srcOffset, VkBuffer dstBuffer, VkDeviceSize size) {
+        std::lock_guard<std::mutex> lock(upload_mutex_);
+
+        UploadBatch& batch = BeginUploadBatch();
+        VkCommandBuffer commandBuffer = GetTransferCommandBuffer(batch);
 
         VkBufferCopy copyRegion = {};
+        copyRegion.srcOffset = srcOffset;
         copyRegion.size = size;
         vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
-        EndCommands(commandBuffer);
-    }
+        VkBufferMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.buffer = dstBuffer;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+
+        if (commandBuffer == batch.graphics_command_buffer) {
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 
-    void CreateCommandBuffers() {
-        command_buffers_.resize(image_count_);
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+        } else {
+            // Release on the transfer queue, acquire on the graphics queue after the batch semaphore.
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = 0;
+            barrier.srcQueueFamilyIndex = transfer_family_index_;
+            barrier.dstQueueFamilyIndex = graphics_family_index_;
 
-        VkCommandBufferAllocateInfo allocate_info = {};
-        allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocate_info.commandPool = command_pool_;
-        allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocate_info.commandBufferCount = (uint32_t)command_buffers_.size();
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
 
-        if (vkAllocateCommandBuffers(device_, &allocate_info, command_buffers_.data()) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate command buffers");
+            vkCmdPipelineBarrier(batch.graphics_command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
         }
     }
 
     void CreateSwapchain(uint32_t window_width, uint32_t window_height) {
+        if (headless_) {
+            CreateHeadlessImages(window_width, window_height);
+        } else {
+            CreateSwapchainImages(window_width, window_height);
+        }
+
+        swapchain_image_views_.resize(image_count_);
+
+        for (size_t i = 0; i < image_count_; i++) {
+            swapchain_image_views_[i] = CreateImageView(swapchain_images_[i], surface_format_.format, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+        }
+
+        VkFormat color_format = surface_format_.format;
+        CreateImage(swapchain_extent_.width, swapchain_extent_.height, 1, msaa_samples_, color_format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, color_image_, color_image_memory_);
+        color_image_view_ = CreateImageView(color_image_, color_format, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+
+        VkFormat depth_format = depth_format_;
+        CreateImage(swapchain_extent_.width, swapchain_extent_.height, 1, msaa_samples_, depth_format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depth_image_, depth_image_memory_);
+        depth_image_view_ = CreateImageView(depth_image_, depth_format, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
+    }
+
+    void CreateHeadlessImages(uint32_t width, uint32_t height) {
+        swapchain_extent_ = {width, height};
+        swapchain_images_.resize(image_count_);
+        headless_image_memory_.resize(image_count_);
+
+        for (uint32_t i = 0; i < image_count_; i++) {
+            CreateImage(width, height, 1, VK_SAMPLE_COUNT_1_BIT, surface_format_.format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, swapchain_images_[i], headless_image_memory_[i]);
+        }
+    }
+
+    void CreateSwapchainImages(uint32_t window_width, uint32_t window_height) {
         VkExtent2D extent = ChooseSwapExtent(window_width, window_height);
 
         VkSwapchainCreateInfoKHR create_info = {};
@@ -1342,7 +2155,7 @@ private:
         create_info.imageColorSpace = surface_format_.colorSpace;
         create_info.imageExtent = extent;
         create_info.imageArrayLayers = 1;
-        create_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        create_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | (capabilities_.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
 
         uint32_t queue_family_indices[] = {graphics_family_index_, present_family_index_};
 
@@ -1368,43 +2181,32 @@ private:
         vkGetSwapchainImagesKHR(device_, swapchain_, &image_count_, swapchain_images_.data());
 
         swapchain_extent_ = extent;
-
-        swapchain_image_views_.resize(image_count_);
-
-        for (size_t i = 0; i < image_count_; i++) {
-            swapchain_image_views_[i] = CreateImageView(swapchain_images_[i], surface_format_.format, VK_IMAGE_ASPECT_COLOR_BIT, 1);
-        }
-
-        VkFormat color_format = surface_format_.format;
-        CreateImage(swapchain_extent_.width, swapchain_extent_.height, 1, msaa_samples_, color_format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, color_image_, color_image_memory_);
-        color_image_view_ = CreateImageView(color_image_, color_format, VK_IMAGE_ASPECT_COLOR_BIT, 1);
-
-        VkFormat depth_format = depth_format_;
-        CreateImage(swapchain_extent_.width, swapchain_extent_.height, 1, msaa_samples_, depth_format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depth_image_, depth_image_memory_);
-        depth_image_view_ = CreateImageView(depth_image_, depth_format, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
-
-        CreateCommandBuffers();
     }
 
     void DestroySwapchain() {
-        vkFreeCommandBuffers(device_, command_pool_, static_cast<uint32_t>(command_buffers_.size()), command_buffers_.data());
-
         vkDestroyImageView(device_, depth_image_view_, nullptr);
         vkDestroyImage(device_, depth_image_, nullptr);
-        vkFreeMemory(device_, depth_image_memory_, nullptr);
+        allocator_.Free(depth_image_memory_);
 
         vkDestroyImageView(device_, color_image_view_, nullptr);
         vkDestroyImage(device_, color_image_, nullptr);
-        vkFreeMemory(device_, color_image_memory_, nullptr);
+        allocator_.Free(color_image_memory_);
 
         for (auto image_view : swapchain_image_views_) {
             vkDestroyImageView(device_, image_view, nullptr);
         }
 
-        vkDestroySwapchainKHR(device_, swapchain_, nullptr);
+        if (headless_) {
+            for (uint32_t i = 0; i < swapchain_images_.size(); i++) {
+                vkDestroyImage(device_, swapchain_images_[i], nullptr);
+                allocator_.Free(headless_image_memory_[i]);
+            }
+        } else {
+            vkDestroySwapchainKHR(device_, swapchain_, nullptr);
+        }
     }
 
-    void CreateImage(uint32_t width, uint32_t height, uint32_t mip_levels, VkSampleCountFlagBits num_samples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& image_memory) {
+    void CreateImage(uint32_t width, uint32_t height, uint32_t mip_levels, VkSampleCountFlagBits num_samples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, Allocation& image_memory) {
         VkImageCreateInfo image_info = {};
         image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
         image_info.imageType = VK_IMAGE_TYPE_2D;
@@ -1427,16 +2229,9 @@ private:
         VkMemoryRequirements memory_requirements;
         vkGetImageMemoryRequirements(device_, image, &memory_requirements);
 
-        VkMemoryAllocateInfo allocate_info = {};
-        allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocate_info.allocationSize = memory_requirements.size;
-        allocate_info.memoryTypeIndex = FindMemoryType(memory_requirements.memoryTypeBits, properties);
+        image_memory = allocator_.Allocate(memory_requirements, properties, tiling == VK_IMAGE_TILING_LINEAR);
 
-        if (vkAllocateMemory(device_, &allocate_info, nullptr, &image_memory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate image memory");
-        }
-
-        vkBindImageMemory(device_, image, image_memory, 0);
+        vkBindImageMemory(device_, image, image_memory.memory, image_memory.offset);
     }
 
     VkImageView CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspect_flags, uint32_t mip_levels) {
@@ -1459,36 +2254,38 @@ private:
         return image_view;
     }
 
-    void CreateRenderPass(uint32_t subpass_count_, VkRenderPass& render_pass_) {
+    void CreateRenderPass(const RenderPassKey& key, VkRenderPass& render_pass_) {
+        uint32_t subpass_count_ = key.subpass_count;
+
         VkAttachmentDescription color_attachment = {};
-        color_attachment.format = surface_format_.format;
-        color_attachment.samples = msaa_samples_;
-        color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        color_attachment.format = key.color_format;
+        color_attachment.samples = key.samples;
+        color_attachment.loadOp = key.color_load_op;
+        color_attachment.storeOp = key.color_store_op;
         color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        color_attachment.initialLayout = key.color_load_op == VK_ATTACHMENT_LOAD_OP_LOAD ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
         color_attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
         VkAttachmentDescription depth_attachment = {};
-        depth_attachment.format = depth_format_;
-        depth_attachment.samples = msaa_samples_;
-        depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depth_attachment.format = key.depth_format;
+        depth_attachment.samples = key.samples;
+        depth_attachment.loadOp = key.depth_load_op;
+        depth_attachment.storeOp = key.depth_store_op;
         depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         depth_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
         depth_attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
         VkAttachmentDescription color_attachment_resolve = {};
-        color_attachment_resolve.format = surface_format_.format;
+        color_attachment_resolve.format = key.color_format;
         color_attachment_resolve.samples = VK_SAMPLE_COUNT_1_BIT;
         color_attachment_resolve.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         color_attachment_resolve.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         color_attachment_resolve.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         color_attachment_resolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         color_attachment_resolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        color_attachment_resolve.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        color_attachment_resolve.finalLayout = headless_ ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
         VkAttachmentReference color_attachment_reference = {};
         color_attachment_reference.attachment = 0;
@@ -1515,22 +2312,31 @@ private:
             subpasses.push_back(subpass);
         }
 
+        // A pass that loads the color attachment reads what the previous pass wrote to it, so those
+        // writes have to be made available first.
+        VkAccessFlags external_src_access = 0;
+        VkAccessFlags external_dst_access = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        if (key.color_load_op == VK_ATTACHMENT_LOAD_OP_LOAD) {
+            external_src_access = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+            external_dst_access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        }
+
         VkSubpassDependency dependency = {};
         if (subpass_count_ == 1) {
             dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
             dependency.dstSubpass = 0;
             dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-            dependency.srcAccessMask = 0;
+            dependency.srcAccessMask = external_src_access;
             dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-            dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+            dependency.dstAccessMask = external_dst_access;
             dependencies.push_back(dependency);
         } else if (subpass_count_ > 1) {
             dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
             dependency.dstSubpass = 0;
             dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-            dependency.srcAccessMask = 0;
+            dependency.srcAccessMask = external_src_access;
             dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-            dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+            dependency.dstAccessMask = external_dst_access;
             dependencies.push_back(dependency);
 
             for (uint32_t subpass = 1; subpass < subpass_count_; subpass++) {
@@ -1559,50 +2365,85 @@ private:
         }
     }
 
-    void CreateFramebuffers(VkRenderPass& render_pass, std::vector<VkFramebuffer>& framebuffers) {
-        framebuffers.resize(swapchain_image_views_.size());
+    VkRenderPass GetRenderPass(uint32_t subpass_count, bool load) {
+        RenderPassKey key{};
+        key.color_format = surface_format_.format;
+        key.depth_format = depth_format_;
+        key.samples = msaa_samples_;
+        key.color_load_op = load ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+        key.color_store_op = VK_ATTACHMENT_STORE_OP_STORE;
+        key.depth_load_op = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        key.depth_store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        key.subpass_count = subpass_count;
+
+        auto cached = render_pass_cache_.find(key);
+        if (cached != render_pass_cache_.end()) {
+            return cached->second;
+        }
+
+        VkRenderPass render_pass{};
+        CreateRenderPass(key, render_pass);
+        render_pass_cache_[key] = render_pass;
+
+        return render_pass;
+    }
+
+    VkFramebuffer GetFramebuffer(VkRenderPass render_pass, const std::array<VkImageView, 3>& attachments) {
+        FramebufferKey key{render_pass, attachments, swapchain_extent_.width, swapchain_extent_.height};
+
+        auto cached = framebuffer_cache_.find(key);
+        if (cached != framebuffer_cache_.end()) {
+            return cached->second;
+        }
+
+        VkFramebufferCreateInfo framebuffer_info = {};
+        framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebuffer_info.renderPass = render_pass;
+        framebuffer_info.attachmentCount = static_cast<uint32_t>(attachments.size());
+        framebuffer_info.pAttachments = attachments.data();
+        framebuffer_info.width = swapchain_extent_.width;
+        framebuffer_info.height = swapchain_extent_.height;
+        framebuffer_info.layers = 1;
+
+        VkFramebuffer framebuffer{};
+        if (vkCreateFramebuffer(device_, &framebuffer_info, nullptr, &framebuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create framebuffer");
+        }
+        framebuffer_cache_[key] = framebuffer;
+
+        return framebuffer;
+    }
+
+    void AcquireRenderPass(std::shared_ptr<RenderPass>& render_pass) {
+        render_pass->render_pass_ = GetRenderPass(render_pass->subpass_count_, render_pass->load_);
 
+        render_pass->framebuffers_.resize(swapchain_image_views_.size());
         for (size_t i = 0; i < swapchain_image_views_.size(); i++) {
-            std::array<VkImageView, 3> attachments = {
-                color_image_view_,
-                depth_image_view_,
-                swapchain_image_views_[i]
-            };
-
-            VkFramebufferCreateInfo framebuffer_info = {};
-            framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-            framebuffer_info.renderPass = render_pass;
-            framebuffer_info.attachmentCount = static_cast<uint32_t>(attachments.size());
-            framebuffer_info.pAttachments = attachments.data();
-            framebuffer_info.width = swapchain_extent_.width;
-            framebuffer_info.height = swapchain_extent_.height;
-            framebuffer_info.layers = 1;
-
-            if (vkCreateFramebuffer(device_, &framebuffer_info, nullptr, &framebuffers[i]) != VK_SUCCESS) {
-                throw std::runtime_error("failed to create framebuffer");
-            }
+            render_pass->framebuffers_[i] = GetFramebuffer(render_pass->render_pass_, {color_image_view_, depth_image_view_, swapchain_image_views_[i]});
         }
     }
 
-    void DestroyRenderPass(std::shared_ptr<RenderPass>& render_pass) {
-        for (auto& framebuffer : render_pass->framebuffers_) {
-            if (framebuffer != nullptr) {
-                vkDestroyFramebuffer(device_, framebuffer, nullptr);
-                framebuffer = nullptr;
-            }
+    void DestroyFramebufferCache() {
+        for (auto& framebuffer : framebuffer_cache_) {
+            vkDestroyFramebuffer(device_, framebuffer.second, nullptr);
         }
-        render_pass->framebuffers_.clear();
-        if (render_pass->render_pass_ != nullptr) {
-            vkDestroyRenderPass(device_, render_pass->render_pass_, nullptr);
-            render_pass->render_pass_ = nullptr;
+        framebuffer_cache_.clear();
+    }
+
+    void DestroyRenderPassCache() {
+        for (auto& render_pass : render_pass_cache_) {
+            vkDestroyRenderPass(device_, render_pass.second, nullptr);
         }
+        render_pass_cache_.clear();
     }
 
-    void CreateSyncObjects() {
-        image_available_semaphores_.resize(max_frames_in_flight_);
-        render_finished_semaphores_.resize(max_frames_in_flight_);
-        in_flight_fences_.resize(max_frames_in_flight_);
-        images_in_flight_.resize(image_count_, VK_NULL_HANDLE);
+    void CreateFrameContexts() {
+        frames_.resize(max_frames_in_flight_);
+
+        VkCommandPoolCreateInfo pool_info = {};
+        pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        pool_info.queueFamilyIndex = graphics_family_index_;
 
         VkSemaphoreCreateInfo semaphore_info = {};
         semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -1611,13 +2452,487 @@ private:
         fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
         fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-        for (size_t i = 0; i < max_frames_in_flight_; i++) {
-            if (vkCreateSemaphore(device_, &semaphore_info, nullptr, &image_available_semaphores_[i]) != VK_SUCCESS ||
-                vkCreateSemaphore(device_, &semaphore_info, nullptr, &render_finished_semaphores_[i]) != VK_SUCCESS ||
-                vkCreateFence(device_, &fence_info, nullptr, &in_flight_fences_[i]) != VK_SUCCESS) {
+        for (auto& frame : frames_) {
+            if (vkCreateCommandPool(device_, &pool_info, nullptr, &frame.command_pool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create command pool");
+            }
+
+            VkCommandBufferAllocateInfo allocate_info = {};
+            allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocate_info.commandPool = frame.command_pool;
+            allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocate_info.commandBufferCount = 1;
+
+            if (vkAllocateCommandBuffers(device_, &allocate_info, &frame.command_buffer) != VK_SUCCESS ||
+                vkAllocateCommandBuffers(device_, &allocate_info, &frame.capture_command_buffer) != VK_SUCCESS ||
+                vkAllocateCommandBuffers(device_, &allocate_info, &frame.profiler_command_buffer) != VK_SUCCESS ||
+                vkAllocateCommandBuffers(device_, &allocate_info, &frame.overlay_command_buffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate command buffers");
+            }
+
+            if (vkCreateSemaphore(device_, &semaphore_info, nullptr, &frame.image_available_semaphore) != VK_SUCCESS ||
+                vkCreateSemaphore(device_, &semaphore_info, nullptr, &frame.render_finished_semaphore) != VK_SUCCESS ||
+                vkCreateFence(device_, &fence_info, nullptr, &frame.in_flight_fence) != VK_SUCCESS) {
                 throw std::runtime_error("failed to create synchronization objects for a frame");
             }
+
+            frame.transient_descriptor_allocator = std::make_unique<DescriptorAllocator>();
+            frame.transient_descriptor_allocator->Initialize(device_, false, 256);
+
+            frame.secondary_command_pools.resize(job_system_.GetWorkerCount());
+            for (auto& secondary : frame.secondary_command_pools) {
+                if (vkCreateCommandPool(device_, &pool_info, nullptr, &secondary.command_pool) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to create command pool");
+                }
+            }
+        }
+
+        current_frame_ = 0;
+    }
+
+    void CreateCaptureBuffers() {
+        VkDeviceSize size = static_cast<VkDeviceSize>(swapchain_extent_.width) * swapchain_extent_.height * 4;
+
+        capture_buffers_.resize(max_frames_in_flight_ + capture_buffers_beyond_frames_);
+        free_capture_buffers_.clear();
+        for (uint32_t index = 0; index < capture_buffers_.size(); index++) {
+            capture_buffers_[index].size = size;
+            // The encoder reads every pixel back and coherent memory is often uncached, so cached memory
+            // is preferred and invalidated in CollectCapture.
+            CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, capture_buffers_[index].buffer, capture_buffers_[index].memory, VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+            free_capture_buffers_.push_back(index);
+        }
+    }
+
+    void DestroyCaptureBuffers() {
+        for (auto& buffer : capture_buffers_) {
+            vkDestroyBuffer(device_, buffer.buffer, nullptr);
+            allocator_.Free(buffer.memory);
+        }
+        capture_buffers_.clear();
+        free_capture_buffers_.clear();
+    }
+
+    // Appends the copy of the resolved image to a second command buffer submitted after the scene's.
+    bool RecordCapture(FrameContext& frame, uint32_t image_index) {
+        {
+            std::lock_guard<std::mutex> lock(capture_mutex_);
+            if (free_capture_buffers_.empty()) {
+                captures_dropped_++;
+                return false;
+            }
+            frame.capture_buffer = free_capture_buffers_.back();
+            free_capture_buffers_.pop_back();
+        }
+        frame.capture_frame_number = capture_frame_number_++;
+
+        VkCommandBuffer command_buffer = frame.capture_command_buffer;
+
+        VkCommandBufferBeginInfo begin_info = {};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording capture command buffer");
+        }
+
+        VkImageLayout output_layout = headless_ ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+        VkImageMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.oldLayout = output_layout;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = swapchain_images_[image_index];
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.levelCount = 1;
+        barrier.subresourceRange.layerCount = 1;
+
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        VkBufferImageCopy region = {};
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = {swapchain_extent_.width, swapchain_extent_.height, 1};
+
+        Buffer& buffer = capture_buffers_[frame.capture_buffer];
+        vkCmdCopyImageToBuffer(command_buffer, swapchain_images_[image_index], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer.buffer, 1, &region);
+
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = 0;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout = output_layout;
+
+        VkBufferMemoryBarrier buffer_barrier = {};
+        buffer_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        buffer_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        buffer_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        buffer_barrier.buffer = buffer.buffer;
+        buffer_barrier.size = VK_WHOLE_SIZE;
+
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &buffer_barrier, 0, nullptr);
+
+        if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record capture command buffer");
+        }
+
+        return true;
+    }
+
+    // Must only be called once the frame's fence has signalled.
+    void CollectCapture(FrameContext& frame) {
+        if (frame.capture_buffer == UINT32_MAX) {
+            return;
+        }
+
+        FrameCapture::Frame capture{};
+        capture.buffer = frame.capture_buffer;
+        capture.number = frame.capture_frame_number;
+        capture.width = swapchain_extent_.width;
+        capture.height = swapchain_extent_.height;
+        capture.bgra = surface_format_.format == VK_FORMAT_B8G8R8A8_SRGB || surface_format_.format == VK_FORMAT_B8G8R8A8_UNORM;
+        capture.pixels = static_cast<const unsigned char*>(capture_buffers_[frame.capture_buffer].memory.mapped);
+        allocator_.Invalidate(capture_buffers_[frame.capture_buffer].memory);
+        frame_capture_.Push(capture);
+
+        frame.capture_buffer = UINT32_MAX;
+    }
+
+    // Must only be called once the device is idle.
+    void CollectCaptures() {
+        for (auto& frame : frames_) {
+            CollectCapture(frame);
+        }
+    }
+
+    VkCommandBuffer GetSecondaryCommandBuffer(SecondaryCommandPool& secondary) {
+        if (secondary.used == secondary.command_buffers.size()) {
+            VkCommandBufferAllocateInfo allocate_info = {};
+            allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocate_info.commandPool = secondary.command_pool;
+            allocate_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocate_info.commandBufferCount = 1;
+
+            VkCommandBuffer command_buffer{};
+            if (vkAllocateCommandBuffers(device_, &allocate_info, &command_buffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate secondary command buffer");
+            }
+            secondary.command_buffers.push_back(command_buffer);
+        }
+
+        return secondary.command_buffers[secondary.used++];
+    }
+
+    void DestroyFrameContexts() {
+        for (auto& frame : frames_) {
+            frame.transient_descriptor_allocator->Destroy();
+            for (auto& secondary : frame.secondary_command_pools) {
+                vkDestroyCommandPool(device_, secondary.command_pool, nullptr);
+            }
+            vkDestroyFence(device_, frame.in_flight_fence, nullptr);
+            vkDestroySemaphore(device_, frame.render_finished_semaphore, nullptr);
+            vkDestroySemaphore(device_, frame.image_available_semaphore, nullptr);
+            vkDestroyCommandPool(device_, frame.command_pool, nullptr);
+        }
+        frames_.clear();
+    }
+
+    void CreateGpuProfiler() {
+        uint32_t queue_family_count = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(physical_device_, &queue_family_count, nullptr);
+        std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
+        vkGetPhysicalDeviceQueueFamilyProperties(physical_device_, &queue_family_count, queue_families.data());
+
+        gpu_profiler_.Initialize(device_, limits_.timestampPeriod, queue_families[graphics_family_index_].timestampValidBits, max_frames_in_flight_);
+    }
+
+    // Runs at the start of every AcquireNextImage, which closes the previous frame.
+    void RecordFrameStatistics(std::chrono::steady_clock::time_point now) {
+        if (frame_start_time_ != std::chrono::steady_clock::time_point{}) {
+            float frame_ms = std::chrono::duration<float, std::milli>(now - frame_start_time_).count();
+            frame_statistics_.Add(FrameStatistics::Metric::frame, frame_ms);
+            frame_statistics_.Add(FrameStatistics::Metric::cpu, std::max(frame_ms - acquire_wait_ms_ - present_wait_ms_, 0.0f));
+            frame_statistics_.Add(FrameStatistics::Metric::acquire, acquire_wait_ms_);
+            frame_statistics_.Add(FrameStatistics::Metric::present, present_wait_ms_);
+        }
+        frame_start_time_ = now;
+        acquire_wait_ms_ = 0.0f;
+        present_wait_ms_ = 0.0f;
+    }
+
+    static float MillisecondsSince(std::chrono::steady_clock::time_point start_time) {
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+    }
+
+    void RecordOverlay(FrameContext& frame, uint32_t image_index) {
+        VkCommandBufferBeginInfo begin_info = {};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (vkBeginCommandBuffer(frame.overlay_command_buffer, &begin_info) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording overlay command buffer");
+        }
+
+        overlay_(frame.overlay_command_buffer, image_index);
+
+        if (vkEndCommandBuffer(frame.overlay_command_buffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record overlay command buffer");
+        }
+    }
+
+    bool RecordProfilerReset(FrameContext& frame) {
+        VkCommandBufferBeginInfo begin_info = {};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (vkBeginCommandBuffer(frame.profiler_command_buffer, &begin_info) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording profiler command buffer");
+        }
+
+        bool recorded = gpu_profiler_.RecordReset(frame.profiler_command_buffer);
+
+        if (vkEndCommandBuffer(frame.profiler_command_buffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record profiler command buffer");
+        }
+
+        return recorded;
+    }
+
+    void CreateDescriptorAllocators() {
+        descriptor_layout_cache_.Initialize(device_);
+        descriptor_allocator_.Initialize(device_, true);
+    }
+
+    void DestroyDescriptorAllocators() {
+        descriptor_allocator_.Destroy();
+        descriptor_layout_cache_.Destroy();
+    }
+
+    void CreateBindlessTable() {
+        bindless_texture_capacity_ = std::min<uint32_t>(max_bindless_textures_, limits_.maxPerStageDescriptorSampledImages);
+
+        VkSamplerCreateInfo sampler_info = {};
+        sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        sampler_info.magFilter = VK_FILTER_LINEAR;
+        sampler_info.minFilter = VK_FILTER_LINEAR;
+        sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        sampler_info.anisotropyEnable = VK_TRUE;
+        sampler_info.maxAnisotropy = 16;
+        sampler_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+        sampler_info.compareOp = VK_COMPARE_OP_ALWAYS;
+        sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        sampler_info.maxLod = VK_LOD_CLAMP_NONE;
+
+        if (vkCreateSampler(device_, &sampler_info, nullptr, &bindless_samplers_[bindless_sampler_linear]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create bindless sampler");
+        }
+
+        sampler_info.magFilter = VK_FILTER_NEAREST;
+        sampler_info.minFilter = VK_FILTER_NEAREST;
+        sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        sampler_info.anisotropyEnable = VK_FALSE;
+        sampler_info.maxAnisotropy = 1;
+        sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+
+        if (vkCreateSampler(device_, &sampler_info, nullptr, &bindless_samplers_[bindless_sampler_nearest]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create bindless sampler");
+        }
+
+        std::array<VkDescriptorSetLayoutBinding, 2> bindings = {};
+        bindings[0].binding = 0;
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        bindings[0].descriptorCount = bindless_texture_capacity_;
+        bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        bindings[1].binding = 1;
+        bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+        bindings[1].descriptorCount = bindless_sampler_count;
+        bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        bindings[1].pImmutableSamplers = bindless_samplers_.data();
+
+        std::array<VkDescriptorBindingFlags, 2> binding_flags = {VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT, 0};
+
+        VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info = {};
+        binding_flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        binding_flags_info.bindingCount = static_cast<uint32_t>(binding_flags.size());
+        binding_flags_info.pBindingFlags = binding_flags.data();
+
+        VkDescriptorSetLayoutCreateInfo layout_info = {};
+        layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layout_info.pNext = &binding_flags_info;
+        layout_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+        layout_info.bindingCount = static_cast<uint32_t>(bindings.size());
+        layout_info.pBindings = bindings.data();
+
+        if (vkCreateDescriptorSetLayout(device_, &layout_info, nullptr, &bindless_set_layout_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create bindless descriptor set layout");
+        }
+
+        std::array<VkDescriptorPoolSize, 2> pool_sizes = {};
+        pool_sizes[0].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        pool_sizes[0].descriptorCount = bindless_texture_capacity_;
+        pool_sizes[1].type = VK_DESCRIPTOR_TYPE_SAMPLER;
+        pool_sizes[1].descriptorCount = bindless_sampler_count;
+
+        VkDescriptorPoolCreateInfo pool_info = {};
+        pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+        pool_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
+        pool_info.pPoolSizes = pool_sizes.data();
+        pool_info.maxSets = 1;
+
+        if (vkCreateDescriptorPool(device_, &pool_info, nullptr, &bindless_pool_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create bindless descriptor pool");
+        }
+
+        VkDescriptorSetAllocateInfo allocate_info = {};
+        allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocate_info.descriptorPool = bindless_pool_;
+        allocate_info.descriptorSetCount = 1;
+        allocate_info.pSetLayouts = &bindless_set_layout_;
+
+        if (vkAllocateDescriptorSets(device_, &allocate_info, &bindless_set_) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate bindless descriptor set");
+        }
+    }
+
+    void DestroyBindlessTable() {
+        vkDestroyDescriptorPool(device_, bindless_pool_, nullptr);
+        vkDestroyDescriptorSetLayout(device_, bindless_set_layout_, nullptr);
+        for (auto& sampler : bindless_samplers_) {
+            vkDestroySampler(device_, sampler, nullptr);
+        }
+    }
+
+    void WriteDescriptorSet(std::shared_ptr<DescriptorSet>& descriptor_set, VkDescriptorSet descriptor_set_handle, const std::vector<TextureSampler>& textures) {
+        std::array<VkWriteDescriptorSet, 1 + max_image_samplers_per_set_> descriptor_writes{};
+        std::array<VkDescriptorBufferInfo, max_uniform_buffers_per_set_> buffer_infos{};
+        std::array<VkDescriptorImageInfo, max_image_samplers_per_set_> image_infos{};
+        uint32_t write_count = 0;
+
+        uint32_t binding = 0;
+
+        uint32_t uniform_buffer_count = static_cast<uint32_t>(descriptor_set->uniform_buffers.size());
+
+        for (uint32_t uniform_buffer_index = 0; uniform_buffer_index < uniform_buffer_count; uniform_buffer_index++) {
+            buffer_infos[uniform_buffer_index].buffer = uniform_arena_buffer_;
+            buffer_infos[uniform_buffer_index].offset = 0;
+            buffer_infos[uniform_buffer_index].range = descriptor_set->uniform_buffers[uniform_buffer_index]->size_;
+        }
+
+        if (uniform_buffer_count > 0) {
+            VkWriteDescriptorSet& write_descriptor_set = descriptor_writes[write_count++];
+            write_descriptor_set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write_descriptor_set.dstSet = descriptor_set_handle;
+            write_descriptor_set.dstBinding = binding;
+            write_descriptor_set.dstArrayElement = 0;
+            write_descriptor_set.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+            write_descriptor_set.descriptorCount = uniform_buffer_count;
+            write_descriptor_set.pBufferInfo = buffer_infos.data();
+            binding += uniform_buffer_count;
+        }
+
+        uint32_t image_sampler_count = std::min(descriptor_set->image_sampler_count, static_cast<uint32_t>(textures.size()));
+
+        for (uint32_t index = 0; index < image_sampler_count; index++) {
+            image_infos[index].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            image_infos[index].imageView = textures[index].texture_image_view_;
+            image_infos[index].sampler = textures[index].texture_sampler_;
+
+            VkWriteDescriptorSet& write_descriptor_set = descriptor_writes[write_count++];
+            write_descriptor_set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write_descriptor_set.dstSet = descriptor_set_handle;
+            write_descriptor_set.dstBinding = binding++;
+            write_descriptor_set.dstArrayElement = 0;
+            write_descriptor_set.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            write_descriptor_set.descriptorCount = 1;
+            write_descriptor_set.pImageInfo = &image_infos[index];
+        }
+
+        vkUpdateDescriptorSets(device_, write_count, descriptor_writes.data(), 0, nullptr);
+    }
+
+    void CreateUniformArena() {
+        VkDeviceSize arena_size = uniform_arena_frame_size_ * max_frames_in_flight_;
+        CreateBuffer(arena_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniform_arena_buffer_, uniform_arena_memory_);
+        uniform_arena_head_ = 0;
+    }
+
+    void DestroyUniformArena() {
+        vkDestroyBuffer(device_, uniform_arena_buffer_, nullptr);
+        allocator_.Free(uniform_arena_memory_);
+    }
+
+    bool IsPipelineCacheCompatible(const std::vector<unsigned char>& data) {
+        struct PipelineCacheHeader {
+            uint32_t header_size;
+            uint32_t header_version;
+            uint32_t vendor_id;
+            uint32_t device_id;
+            uint8_t cache_uuid[VK_UUID_SIZE];
+        };
+
+        PipelineCacheHeader header{};
+        if (data.size() < sizeof(header)) {
+            return false;
+        }
+        memcpy(&header, data.data(), sizeof(header));
+
+        return header.header_size >= sizeof(header) && header.header_version == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+               header.vendor_id == physical_device_properties_.vendorID && header.device_id == physical_device_properties_.deviceID &&
+               memcmp(header.cache_uuid, physical_device_properties_.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    }
+
+    void CreatePipelineCache() {
+        std::vector<unsigned char> data{};
+        try {
+            data = Utility::ReadFile(pipeline_cache_file_);
+        } catch (const std::runtime_error&) {
+            // No cache yet; the driver starts from an empty one.
+        }
+
+        if (!IsPipelineCacheCompatible(data)) {
+            data.clear();
+        }
+
+        VkPipelineCacheCreateInfo cache_info = {};
+        cache_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        cache_info.initialDataSize = data.size();
+        cache_info.pInitialData = data.empty() ? nullptr : data.data();
+
+        if (vkCreatePipelineCache(device_, &cache_info, nullptr, &pipeline_cache_) != VK_SUCCESS) {
+            cache_info.initialDataSize = 0;
+            cache_info.pInitialData = nullptr;
+            if (vkCreatePipelineCache(device_, &cache_info, nullptr, &pipeline_cache_) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create pipeline cache");
+            }
+        }
+    }
+
+    void DestroyPipelineCache() {
+        size_t data_size = 0;
+        if (vkGetPipelineCacheData(device_, pipeline_cache_, &data_size, nullptr) == VK_SUCCESS && data_size > 0) {
+            std::vector<unsigned char> data(data_size);
+            if (vkGetPipelineCacheData(device_, pipeline_cache_, &data_size, data.data()) == VK_SUCCESS) {
+                data.resize(data_size);
+                try {
+                    Utility::WriteFile(pipeline_cache_file_, data);
+                } catch (const std::runtime_error&) {
+                    // Losing the cache only costs compile time on the next start.
+                }
+            }
         }
+
+        vkDestroyPipelineCache(device_, pipeline_cache_, nullptr);
     }
 
     VkExtent2D ChooseSwapExtent(uint32_t windowWidth, uint32_t windowHeight) {
@@ -1643,7 +2958,9 @@ private:
             throw std::runtime_error("texture image format does not support linear blitting");
         }
 
-        VkCommandBuffer command_buffer = BeginCommands();
+        std::lock_guard<std::mutex> lock(upload_mutex_);
+
+        VkCommandBuffer command_buffer = BeginUploadBatch().graphics_command_buffer;
 
         VkImageMemoryBarrier barrier = {};
         barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -1706,15 +3023,15 @@ private:
         barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
         vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-        EndCommands(command_buffer);
     }
 
-    void CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
-        VkCommandBuffer command_buffer = BeginCommands();
+    void CopyBufferToImage(VkBuffer buffer, VkDeviceSize buffer_offset, VkImage image, uint32_t width, uint32_t height) {
+        std::lock_guard<std::mutex> lock(upload_mutex_);
+
+        VkCommandBuffer command_buffer = BeginUploadBatch().graphics_command_buffer;
 
         VkBufferImageCopy region = {};
-        region.bufferOffset = 0;
+        region.bufferOffset = buffer_offset;
         region.bufferRowLength = 0;
         region.bufferImageHeight = 0;
         region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -1725,12 +3042,12 @@ private:
         region.imageExtent = {width, height, 1};
 
         vkCmdCopyBufferToImage(command_buffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-        EndCommands(command_buffer);
     }
 
     void TransformImageLayout(VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout, uint32_t mipLevels) {
-        VkCommandBuffer command_buffer = BeginCommands();
+        std::lock_guard<std::mutex> lock(upload_mutex_);
+
+        VkCommandBuffer command_buffer = BeginUploadBatch().graphics_command_buffer;
 
         VkImageMemoryBarrier barrier = {};
         barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -1765,40 +3082,5 @@ private:
         }
 
         vkCmdPipelineBarrier(command_buffer, source_stage, destination_stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-        EndCommands(command_buffer);
-    }
-
-    VkCommandBuffer BeginCommands() {
-        VkCommandBufferAllocateInfo allocate_info = {};
-        allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocate_info.commandPool = command_pool_;
-        allocate_info.commandBufferCount = 1;
-
-        VkCommandBuffer command_buffer;
-        vkAllocateCommandBuffers(device_, &allocate_info, &command_buffer);
-
-        VkCommandBufferBeginInfo begin_info = {};
-        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-        vkBeginCommandBuffer(command_buffer, &begin_info);
-
-        return command_buffer;
-    }
-
-    void EndCommands(VkCommandBuffer command_buffer) {
-        vkEndCommandBuffer(command_buffer);
-
-        VkSubmitInfo submit_info = {};
-        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submit_info.commandBufferCount = 1;
-        submit_info.pCommandBuffers = &command_buffer;
-
-        vkQueueSubmit(graphics_queue_, 1, &submit_info, VK_NULL_HANDLE);
-        vkQueueWaitIdle(graphics_queue_);
-
-        vkFreeCommandBuffers(device_, command_pool_, 1, &command_buffer);
     }
 };
@@ -7,10 +7,15 @@
 
 class Scene {
 public:
+    virtual const char* GetName() = 0;
     virtual void OnQuit() = 0;
     virtual void OnEntry() = 0;
     virtual void OnExit() = 0;
-    virtual void Update(std::array<bool, SDL_NUM_SCANCODES>& key_state, bool mouse_capture, int mouse_x, int mouse_y) = 0;
+    // Advances the simulation by one fixed step of delta_time seconds.
+    virtual void Update(float delta_time, std::array<bool, SDL_NUM_SCANCODES>& key_state, bool mouse_capture, int mouse_x, int mouse_y) = 0;
     virtual bool EventHandler(const SDL_Event* event) = 0;
-    virtual void Render() = 0;
+    // False while the scene is still loading assets in the background. Throws when that load failed.
+    virtual bool IsReady() = 0;
+    // alpha in [0, 1) is how far the frame lies between the previous and the latest Update.
+    virtual void Render(float alpha) = 0;
 };
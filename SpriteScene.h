@@ -12,6 +12,10 @@ class SpriteScene : public Scene {
 public:
     SpriteScene(RenderEngine& render_engine) : render_engine_(render_engine) {}
 
+    const char* GetName() {
+        return "Sprite";
+    }
+
     void OnQuit() {
         if (startup_) {
             vkDeviceWaitIdle(render_engine_.device_);
@@ -34,21 +38,25 @@ public:
     void OnExit() {
     }
 
-    void Update(std::array<bool, SDL_NUM_SCANCODES>& key_state, bool mouse_capture, int mouse_x, int mouse_y) {
+    void Update(float delta_time, std::array<bool, SDL_NUM_SCANCODES>& key_state, bool mouse_capture, int mouse_x, int mouse_y) {
     }
 
     bool EventHandler(const SDL_Event* event) {
         return false;
     }
 
-    void Render() {
+    bool IsReady() {
+        return true;
+    }
+
+    void Render(float alpha) {
         uint32_t image_index;
 
         if (!render_engine_.AcquireNextImage(image_index)) {
             return;
         }
 
-        VkCommandBuffer& command_buffer = render_engine_.command_buffers_[image_index];
+        VkCommandBuffer& command_buffer = render_engine_.GetCommandBuffer();
 
         VkCommandBufferBeginInfo begin_info = {};
         begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -71,13 +79,29 @@ public:
         render_pass_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
         render_pass_info.pClearValues = clear_values.data();
 
+        uint32_t zone = render_engine_.GetGpuProfiler().BeginZone(command_buffer, "Sprite pass");
         vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
 
+        render_engine_.SetViewportScissor(command_buffer);
+
         vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline_->graphics_pipeline);
-        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline_->pipeline_layout, 0, 1, &descriptor_set_->descriptor_sets[image_index], 0, nullptr);
-        render_engine_.DrawPrimitive(command_buffer, primitive_);
+        render_engine_.BindDescriptorSet(command_buffer, graphics_pipeline_, image_index);
+
+        if (use_bindless_) {
+            render_engine_.BindBindlessTextures(command_buffer, graphics_pipeline_);
+            render_engine_.BindPrimitive(command_buffer, primitive_);
+
+            for (auto& sprite : sprites_) {
+                vkCmdPushConstants(command_buffer, graphics_pipeline_->pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, offsetof(RenderEngine::BindlessPushConstants, position), sizeof(sprite.position), &sprite.position);
+                vkCmdPushConstants(command_buffer, graphics_pipeline_->pipeline_layout, VK_SHADER_STAGE_FRAGMENT_BIT, offsetof(RenderEngine::BindlessPushConstants, texture_index), sizeof(sprite.texture_index) + sizeof(sprite.sampler_index), &sprite.texture_index);
+                render_engine_.DrawIndexed(command_buffer, primitive_.index_count_);
+            }
+        } else {
+            render_engine_.DrawPrimitive(command_buffer, primitive_);
+        }
 
         vkCmdEndRenderPass(command_buffer);
+        render_engine_.GetGpuProfiler().EndZone(command_buffer, zone);
 
         if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
             throw std::runtime_error("failed to record command buffer");
@@ -99,10 +123,36 @@ private:
     IndexedPrimitive primitive_{};
     TextureSampler texture_;
 
+    bool use_bindless_ = false;
+    std::vector<RenderEngine::BindlessPushConstants> sprites_{};
+
     void Startup() {
         render_pass_ = render_engine_.CreateRenderPass();
 
-        {
+        use_bindless_ = render_engine_.IsBindlessSupported();
+
+        if (use_bindless_) {
+            descriptor_set_ = render_engine_.CreateDescriptorSet({}, 0);
+
+            graphics_pipeline_ = render_engine_.CreateGraphicsPipeline
+            (
+                render_pass_,
+                "shaders/bindless2d/vert.spv",
+                "shaders/bindless/frag.spv",
+                {
+                    PushConstant{offsetof(RenderEngine::BindlessPushConstants, position), sizeof(RenderEngine::BindlessPushConstants::position), VK_SHADER_STAGE_VERTEX_BIT},
+                    PushConstant{offsetof(RenderEngine::BindlessPushConstants, texture_index), sizeof(uint32_t) * 2, VK_SHADER_STAGE_FRAGMENT_BIT}
+                },
+                Vertex_2D::getBindingDescription(),
+                Vertex_2D::getAttributeDescriptions(),
+                descriptor_set_,
+                0,
+                true,
+                false,
+                false,
+                true
+            );
+        } else {
             descriptor_set_ = render_engine_.CreateDescriptorSet({}, 1);
 
             graphics_pipeline_ = render_engine_.CreateGraphicsPipeline
@@ -117,14 +167,20 @@ private:
                 0,
                 true,
                 false,
-                false,
                 false
             );
         }
 
         render_engine_.LoadTexture(SPRITE_PATH, texture_);
 
-        render_engine_.UpdateDescriptorSets(descriptor_set_, {texture_});
+        if (use_bindless_) {
+            RenderEngine::BindlessPushConstants sprite{};
+            sprite.texture_index = render_engine_.RegisterBindlessTexture(texture_);
+            sprite.sampler_index = RenderEngine::bindless_sampler_linear;
+            sprites_.push_back(sprite);
+        } else {
+            render_engine_.UpdateDescriptorSets(descriptor_set_, {texture_});
+        }
 
         {
             std::vector<glm::vec2> vertices{};
@@ -140,6 +196,7 @@ private:
 
             Geometry_2D geometry_sprite{};
             geometry_sprite.AddFaces(vertices, faces, texture_coordinates);
+            geometry_sprite.Weld();
             render_engine_.CreateIndexedPrimitive<Vertex_2D, uint32_t>(geometry_sprite.vertices, geometry_sprite.indices, primitive_);
         }
     }
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+
+#include "Math.h"
+#include "RenderEngine.h"
+#include "FrameStatistics.h"
+#include "Geometry_Color.h"
+#include "Text.h"
+
+// Draws the engine's frame statistics over every scene: percentiles, stutters, a graph of recent frame
+// times and a histogram of them. Install Record with RenderEngine::SetOverlay.
+class StatisticsOverlay {
+public:
+    StatisticsOverlay(RenderEngine& render_engine) : render_engine_(render_engine) {}
+
+    void Register() {
+        render_pass_ = render_engine_.CreateRenderPass(true);
+
+        uniform_buffer_ = render_engine_.CreateUniformBuffer(sizeof(CameraMatrix));
+
+        descriptor_set_ = render_engine_.CreateDescriptorSet({uniform_buffer_}, 0);
+
+        graphics_pipeline_ = render_engine_.CreateGraphicsPipeline
+        (
+            render_pass_,
+            "shaders/overlay/vert.spv",
+            "shaders/overlay/frag.spv",
+            {},
+            Vertex_Color::getBindingDescription(),
+            Vertex_Color::getAttributeDescriptions(),
+            descriptor_set_,
+            0,
+            false,
+            true,
+            true
+        );
+
+        // The geometry changes every frame, so each frame in flight gets its own buffers.
+        primitives_.resize(render_engine_.GetFramesInFlight());
+        for (auto& primitive : primitives_) {
+            render_engine_.AllocateDynamicIndexedPrimitive<Vertex_Color, uint32_t>(max_rectangles_ * 4 * sizeof(Vertex_Color), max_rectangles_ * 6 * sizeof(uint32_t), primitive);
+        }
+
+        text_.Register(render_pass_, 16);
+    }
+
+    void Unregister() {
+        vkDeviceWaitIdle(render_engine_.device_);
+        render_engine_.DestroyGraphicsPipeline(graphics_pipeline_);
+        render_engine_.DestroyDescriptorSet(descriptor_set_);
+        render_engine_.DestroyUniformBuffer(uniform_buffer_);
+
+        for (auto& primitive : primitives_) {
+            render_engine_.DestroyIndexedPrimitive(primitive);
+        }
+        primitives_.clear();
+
+        text_.Unregister();
+    }
+
+    void Record(VkCommandBuffer& command_buffer, uint32_t image_index) {
+        float window_width = static_cast<float>(render_engine_.swapchain_extent_.width);
+        float window_height = static_cast<float>(render_engine_.swapchain_extent_.height);
+
+        FrameStatistics& statistics = render_engine_.GetFrameStatistics();
+        std::vector<float> frame_times = statistics.GetHistory(FrameStatistics::Metric::frame);
+        float stutter_threshold = 2.0f * statistics.Summarize(FrameStatistics::Metric::frame).p50;
+
+        // Matches Text, whose projection puts the origin at the bottom left.
+        float left = margin_;
+        float top = window_height - margin_;
+        float text_bottom = top - padding_ - line_count_ * line_height_;
+        float graph_bottom = text_bottom - padding_ - graph_height_;
+        float histogram_bottom = graph_bottom - padding_ - histogram_height_;
+        float bottom = histogram_bottom - padding_;
+
+        geometry_.vertices.clear();
+        geometry_.indices.clear();
+
+        AddRectangle(left, bottom, panel_width_, top - bottom, {0.05f, 0.05f, 0.05f});
+
+        float graph_left = left + padding_;
+        float graph_width = panel_width_ - 2.0f * padding_;
+        float bar_width = graph_width / FrameStatistics::history_size;
+        for (size_t index = 0; index < frame_times.size(); index++) {
+            float height = std::min(frame_times[index] / graph_max_ms_, 1.0f) * graph_height_;
+            glm::vec3 color = frame_times[index] > stutter_threshold ? glm::vec3{0.9f, 0.2f, 0.2f} : glm::vec3{0.2f, 0.8f, 0.3f};
+            AddRectangle(graph_left + index * bar_width, graph_bottom, std::max(bar_width - 1.0f, 1.0f), height, color);
+        }
+        for (float target_ms : {1000.0f / 60.0f, 1000.0f / 30.0f}) {
+            AddRectangle(graph_left, graph_bottom + target_ms / graph_max_ms_ * graph_height_, graph_width, 1.0f, {0.6f, 0.6f, 0.6f});
+        }
+
+        // Each bucket covers histogram_bucket_ms_, and the last one also holds everything slower.
+        std::array<uint32_t, histogram_bucket_count_> buckets{};
+        for (float frame_time : frame_times) {
+            buckets[std::min(static_cast<uint32_t>(frame_time / histogram_bucket_ms_), histogram_bucket_count_ - 1)]++;
+        }
+        uint32_t largest_bucket = std::max(*std::max_element(buckets.begin(), buckets.end()), 1u);
+        float bucket_width = graph_width / histogram_bucket_count_;
+        for (uint32_t index = 0; index < histogram_bucket_count_; index++) {
+            float height = static_cast<float>(buckets[index]) / largest_bucket * histogram_height_;
+            AddRectangle(graph_left + index * bucket_width, histogram_bottom, bucket_width - 1.0f, height, {0.3f, 0.5f, 0.9f});
+        }
+
+        IndexedPrimitive& primitive = primitives_[render_engine_.GetCurrentFrame()];
+        render_engine_.UpdateDynamicIndexedPrimitive<Vertex_Color, uint32_t>(
+            geometry_.vertices.data(),
+            static_cast<uint32_t>(geometry_.vertices.size()),
+            geometry_.indices.data(),
+            static_cast<uint32_t>(geometry_.indices.size()),
+            primitive);
+
+        text_.DrawBegin();
+        char line[128];
+        float y = top - padding_;
+        glm::vec3 color = {0.9f, 0.9f, 0.9f};
+        DrawLine(left + padding_, y -= line_height_, color, "          p50    p95    p99    max ms");
+        for (auto& metric : metric_names_) {
+            FrameStatistics::Summary summary = statistics.Summarize(metric.metric);
+            snprintf(line, sizeof(line), "%-8s %6.2f %6.2f %6.2f %6.2f", metric.name, summary.p50, summary.p95, summary.p99, summary.max);
+            DrawLine(left + padding_, y -= line_height_, color, line);
+        }
+        uint32_t stutters = statistics.CountStutters();
+        glm::vec3 stutter_color = stutters > 0 ? glm::vec3{0.9f, 0.3f, 0.3f} : color;
+        snprintf(line, sizeof(line), "Stutters %u of %u frames", stutters, static_cast<uint32_t>(frame_times.size()));
+        DrawLine(left + padding_, y -= line_height_, stutter_color, line);
+        text_.DrawEnd();
+
+        camera_.proj = glm::ortho(0.0f, window_width, window_height, 0.0f);
+        render_engine_.UpdateUniformBuffer(uniform_buffer_, &camera_);
+
+        VkRenderPassBeginInfo render_pass_info = {};
+        render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        render_pass_info.renderPass = render_pass_->render_pass_;
+        render_pass_info.framebuffer = render_pass_->framebuffers_[image_index];
+        render_pass_info.renderArea.offset = {0, 0};
+        render_pass_info.renderArea.extent = render_engine_.swapchain_extent_;
+
+        std::array<VkClearValue, 2> clear_values = {};
+        clear_values[1].depthStencil = {1.0f, 0};
+
+        render_pass_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
+        render_pass_info.pClearValues = clear_values.data();
+
+        uint32_t zone = render_engine_.GetGpuProfiler().BeginZone(command_buffer, "Statistics overlay");
+        vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+
+        render_engine_.SetViewportScissor(command_buffer);
+
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline_->graphics_pipeline);
+        render_engine_.BindDescriptorSet(command_buffer, graphics_pipeline_, image_index);
+        render_engine_.DrawPrimitive(command_buffer, primitive);
+
+        text_.Render(command_buffer, image_index);
+
+        vkCmdEndRenderPass(command_buffer);
+        render_engine_.GetGpuProfiler().EndZone(command_buffer, zone);
+    }
+
+private:
+    RenderEngine& render_engine_;
+    std::shared_ptr<RenderEngine::RenderPass> render_pass_{};
+    Text text_{render_engine_};
+
+    std::shared_ptr<RenderEngine::GraphicsPipeline> graphics_pipeline_{};
+    std::shared_ptr<RenderEngine::DescriptorSet> descriptor_set_{};
+    std::shared_ptr<RenderEngine::UniformBuffer> uniform_buffer_{};
+
+    struct CameraMatrix {
+        glm::mat4 proj;
+    };
+
+    CameraMatrix camera_{};
+
+    struct MetricName {
+        FrameStatistics::Metric metric;
+        const char* name;
+    };
+
+    const std::array<MetricName, FrameStatistics::metric_count> metric_names_ = {{
+        {FrameStatistics::Metric::frame, "Frame"},
+        {FrameStatistics::Metric::cpu, "CPU"},
+        {FrameStatistics::Metric::gpu, "GPU"},
+        {FrameStatistics::Metric::acquire, "Acquire"},
+        {FrameStatistics::Metric::present, "Present"},
+    }};
+
+    static const uint32_t max_rectangles_ = 512;
+    static const uint32_t line_count_ = FrameStatistics::metric_count + 2;
+    static const uint32_t histogram_bucket_count_ = 25;
+    const float histogram_bucket_ms_ = 2.0f;
+    const float graph_max_ms_ = 50.0f;
+    const float margin_ = 10.0f;
+    const float padding_ = 8.0f;
+    const float line_height_ = 20.0f;
+    const float panel_width_ = 496.0f;
+    const float graph_height_ = 80.0f;
+    const float histogram_height_ = 48.0f;
+
+    Geometry_Color geometry_{};
+    std::vector<IndexedPrimitive> primitives_{};
+
+    void AddRectangle(float x, float y, float width, float height, glm::vec3 color) {
+        if (geometry_.vertices.size() / 4 >= max_rectangles_ || height <= 0.0f) {
+            return;
+        }
+
+        uint32_t base = static_cast<uint32_t>(geometry_.vertices.size());
+        geometry_.vertices.push_back({{x, y, 0.0f}, color});
+        geometry_.vertices.push_back({{x + width, y, 0.0f}, color});
+        geometry_.vertices.push_back({{x + width, y + height, 0.0f}, color});
+        geometry_.vertices.push_back({{x, y + height, 0.0f}, color});
+        for (uint32_t index : {0u, 1u, 2u, 2u, 3u, 0u}) {
+            geometry_.indices.push_back(base + index);
+        }
+    }
+
+    void DrawLine(float x, float y, glm::vec3 color, const char* text) {
+        glm::vec2 position = {x, y};
+        text_.Draw(color, position, text);
+    }
+};
@@ -11,7 +11,7 @@ class Text {
 public:
     Text(RenderEngine& render_engine) : render_engine_(render_engine) {}
 
-    void Register(std::shared_ptr<RenderEngine::RenderPass> render_pass) {
+    void Register(std::shared_ptr<RenderEngine::RenderPass> render_pass, uint32_t font_size = 36) {
         render_pass_ = render_pass;
         {
             uniform_buffer_ = render_engine_.CreateUniformBuffer(sizeof(CameraMatrix));
@@ -33,18 +33,21 @@ public:
                 0,
                 false,
                 true,
-                false,
                 false
             );
         }
 
-        font_.Initialize("fonts/Inconsolata/Inconsolata-Regular.ttf", 36);
+        font_.Initialize("fonts/Inconsolata/Inconsolata-Regular.ttf", font_size);
 
         render_engine_.UpdateDescriptorSets(descriptor_set_, {font_.texture_});
 
+        // The text can change every frame, so each frame in flight gets its own buffers.
         VkDeviceSize vertex_size = static_cast<VkDeviceSize>(VERTEX_COUNT * sizeof(Vertex_Text));
         VkDeviceSize index_size = static_cast<VkDeviceSize>(INDEX_COUNT * sizeof(uint32_t));
-        render_engine_.AllocateDynamicIndexedPrimitive<Vertex_Text, uint32_t>(vertex_size, index_size, primitive_);
+        primitives_.resize(render_engine_.GetFramesInFlight());
+        for (auto& primitive : primitives_) {
+            render_engine_.AllocateDynamicIndexedPrimitive<Vertex_Text, uint32_t>(vertex_size, index_size, primitive);
+        }
     }
 
     void Unregister() {
@@ -55,7 +58,10 @@ public:
 
         font_.Destroy();
 
-        render_engine_.DestroyIndexedPrimitive(primitive_);
+        for (auto& primitive : primitives_) {
+            render_engine_.DestroyIndexedPrimitive(primitive);
+        }
+        primitives_.clear();
     }
 
     void DrawBegin() {
@@ -87,7 +93,7 @@ public:
             static_cast<uint32_t>(geometry_text_.vertices.size()),
             geometry_text_.indices.data(),
             static_cast<uint32_t>(geometry_text_.indices.size()),
-            primitive_);
+            primitives_[render_engine_.GetCurrentFrame()]);
     }
 
     void Render(VkCommandBuffer& command_buffer, uint32_t image_index) {
@@ -95,21 +101,25 @@ public:
         uint32_t window_height = render_engine_.swapchain_extent_.height;
 
         camera_.proj = glm::ortho(0.0f, static_cast<float>(window_width), static_cast<float>(window_height), 0.0f);
-        render_engine_.UpdateUniformBuffers(uniform_buffer_, &camera_);
+        render_engine_.UpdateUniformBuffer(uniform_buffer_, &camera_);
+
+        uint32_t zone = render_engine_.GetGpuProfiler().BeginZone(command_buffer, "Text");
 
         vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline_->graphics_pipeline);
 
-        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline_->pipeline_layout, 0, 1, &descriptor_set_->descriptor_sets[image_index], 0, nullptr);
+        render_engine_.BindDescriptorSet(command_buffer, graphics_pipeline_, image_index);
 
-        render_engine_.BindPrimitive(command_buffer, primitive_);
+        render_engine_.BindPrimitive(command_buffer, primitives_[render_engine_.GetCurrentFrame()]);
 
         for (auto& text : texts_) {
             push_constants_.color = text.color;
             push_constants_.position = text.position;
             vkCmdPushConstants(command_buffer, graphics_pipeline_->pipeline_layout, VK_SHADER_STAGE_FRAGMENT_BIT, offsetof(PushConstants, color), sizeof(push_constants_.color), &push_constants_.color);
             vkCmdPushConstants(command_buffer, graphics_pipeline_->pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, offsetof(PushConstants, position), sizeof(push_constants_.position), &push_constants_.position);
-            vkCmdDrawIndexed(command_buffer, text.count, 1, text.offset, 0, 0);
+            render_engine_.DrawIndexed(command_buffer, text.count, text.offset);
         }
+
+        render_engine_.GetGpuProfiler().EndZone(command_buffer, zone);
     }
 
 private:
@@ -146,5 +156,5 @@ private:
 
     std::vector<Model> texts_;
 
-    IndexedPrimitive primitive_{};
+    std::vector<IndexedPrimitive> primitives_{};
 };
@@ -1,19 +1,41 @@
 #include "Utility.h"
-
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "VertexWelder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <functional>
 #include <stdexcept>
-#include <unordered_map>
+
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#undef LoadImage
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
 void Utility::LoadImage(const char* file_name, Image& texture) {
+    PROFILE_FUNCTION();
+
     int texture_channels;
     texture.pixels = stbi_load(file_name, &texture.texture_width, &texture.texture_height, &texture_channels, STBI_rgb_alpha);
 
@@ -26,44 +48,676 @@ void Utility::FreeImage(Image& texture) {
     stbi_image_free(texture.pixels);
 }
 
-void Utility::LoadModel(const char* file_name, std::vector<Vertex_Texture>& vertices, std::vector<uint32_t>& indices) {
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string warn, err;
+namespace {
+    // Chunks are cut at line ends, so each one parses independently.
+    const size_t obj_chunk_size = 1024 * 1024;
+    const uint32_t obj_max_chunks = 256;
+
+    // Negative OBJ indices count back from the elements read so far, which a chunk only knows relative to
+    // its own start until every chunk has been counted.
+    enum ObjCornerFlags : uint8_t {
+        obj_position_relative = 1,
+        obj_texcoord_relative = 2,
+        obj_has_texcoord = 4,
+    };
+
+    struct ObjCorner {
+        int64_t position;
+        int64_t texcoord;
+        uint8_t flags;
+    };
+
+    struct ObjChunk {
+        const char* begin{};
+        const char* end{};
+        std::vector<glm::vec3> positions{};
+        std::vector<glm::vec2> texcoords{};
+        std::vector<ObjCorner> corners{};
+        size_t position_base{};
+        size_t texcoord_base{};
+        size_t corner_base{};
+        std::vector<std::vector<uint32_t>> shard_corners{};
+        uint32_t unique_base{};
+        uint32_t unique_count{};
+    };
+
+    void ForEachIndex(JobSystem* job_system, uint32_t count, const std::function<void(uint32_t)>& function) {
+        if (job_system == nullptr) {
+            for (uint32_t index = 0; index < count; index++) {
+                function(index);
+            }
+            return;
+        }
+
+        job_system->ParallelFor(count, 1, [&function](uint32_t index, uint32_t) { function(index); });
+    }
+
+    bool IsObjSpace(char character) {
+        return character == ' ' || character == '\t' || character == '\r';
+    }
+
+    bool IsObjDigit(char character) {
+        return character >= '0' && character <= '9';
+    }
+
+    const char* SkipObjSpaces(const char* cursor, const char* end) {
+        while (cursor < end && IsObjSpace(*cursor)) {
+            cursor++;
+        }
+        return cursor;
+    }
+
+    // Only the decimal and exponent forms OBJ exporters write. Unlike strtof it needs no terminator and
+    // never consults the locale.
+    const char* ParseObjFloat(const char* cursor, const char* end, float& value) {
+        static const double powers[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        cursor = SkipObjSpaces(cursor, end);
+
+        bool negative = false;
+        if (cursor < end && (*cursor == '-' || *cursor == '+')) {
+            negative = *cursor == '-';
+            cursor++;
+        }
+
+        // Digits beyond what a uint64_t holds only shift the exponent.
+        uint64_t mantissa = 0;
+        int32_t exponent = 0;
+        uint32_t digits = 0;
+        for (; cursor < end && IsObjDigit(*cursor); cursor++) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*cursor - '0');
+                digits += mantissa != 0;
+            } else {
+                exponent++;
+            }
+        }
+        if (cursor < end && *cursor == '.') {
+            for (cursor++; cursor < end && IsObjDigit(*cursor); cursor++) {
+                if (digits < 19) {
+                    mantissa = mantissa * 10 + (*cursor - '0');
+                    digits += mantissa != 0;
+                    exponent--;
+                }
+            }
+        }
+        if (cursor < end && (*cursor == 'e' || *cursor == 'E')) {
+            cursor++;
+            bool negative_exponent = false;
+            if (cursor < end && (*cursor == '-' || *cursor == '+')) {
+                negative_exponent = *cursor == '-';
+                cursor++;
+            }
+            int32_t written_exponent = 0;
+            for (; cursor < end && IsObjDigit(*cursor); cursor++) {
+                written_exponent = std::min(written_exponent * 10 + (*cursor - '0'), 100000);
+            }
+            exponent += negative_exponent ? -written_exponent : written_exponent;
+        }
+
+        double result = static_cast<double>(mantissa);
+        if (exponent < 0 && exponent >= -22) {
+            result /= powers[-exponent];
+        } else if (exponent > 0 && exponent <= 22) {
+            result *= powers[exponent];
+        } else if (exponent != 0) {
+            result *= std::pow(10.0, exponent);
+        }
+
+        value = static_cast<float>(negative ? -result : result);
+        return cursor;
+    }
+
+    const char* ParseObjIndex(const char* cursor, const char* end, int64_t& value, bool& found) {
+        bool negative = false;
+        if (cursor < end && *cursor == '-') {
+            negative = true;
+            cursor++;
+        }
+
+        found = false;
+        value = 0;
+        for (; cursor < end && IsObjDigit(*cursor); cursor++) {
+            value = value * 10 + (*cursor - '0');
+            found = true;
+        }
+        if (negative) {
+            value = -value;
+        }
+        return cursor;
+    }
+
+    // Positive indices become absolute and zero-based, negative ones are kept relative to the chunk.
+    bool ResolveObjIndex(int64_t raw, size_t chunk_count, int64_t& index, bool& relative) {
+        relative = raw < 0;
+        index = relative ? static_cast<int64_t>(chunk_count) + raw : raw - 1;
+        return raw != 0;
+    }
+
+    // Reads positions, texture coordinates and faces; faces are split into triangle fans. Normals,
+    // groups, materials and everything else are skipped.
+    void ParseObjChunk(ObjChunk& chunk, const char* file_name) {
+        PROFILE_SCOPE("ParseObjChunk");
+
+        std::vector<ObjCorner> face{};
+        const char* cursor = chunk.begin;
+        while (cursor < chunk.end) {
+            const char* line_end = static_cast<const char*>(memchr(cursor, '\n', chunk.end - cursor));
+            if (line_end == nullptr) {
+                line_end = chunk.end;
+            }
+
+            const char* token = SkipObjSpaces(cursor, line_end);
+            size_t length = line_end - token;
+
+            if (length >= 2 && token[0] == 'v' && IsObjSpace(token[1])) {
+                glm::vec3 position{};
+                const char* value = ParseObjFloat(token + 1, line_end, position.x);
+                value = ParseObjFloat(value, line_end, position.y);
+                ParseObjFloat(value, line_end, position.z);
+                chunk.positions.push_back(position);
+            } else if (length >= 3 && token[0] == 'v' && token[1] == 't' && IsObjSpace(token[2])) {
+                glm::vec2 texcoord{};
+                const char* value = ParseObjFloat(token + 2, line_end, texcoord.x);
+                ParseObjFloat(value, line_end, texcoord.y);
+                chunk.texcoords.push_back(texcoord);
+            } else if (length >= 2 && token[0] == 'f' && IsObjSpace(token[1])) {
+                face.clear();
+                const char* value = token + 1;
+                while (true) {
+                    value = SkipObjSpaces(value, line_end);
+                    if (value >= line_end) {
+                        break;
+                    }
+
+                    ObjCorner corner{};
+                    int64_t raw = 0;
+                    bool found = false;
+                    bool relative = false;
+                    value = ParseObjIndex(value, line_end, raw, found);
+                    if (!found || !ResolveObjIndex(raw, chunk.positions.size(), corner.position, relative)) {
+                        throw std::runtime_error(std::string{"invalid face in "}+file_name);
+                    }
+                    corner.flags |= relative ? obj_position_relative : 0;
+
+                    if (value < line_end && *value == '/') {
+                        value = ParseObjIndex(value + 1, line_end, raw, found);
+                        if (found) {
+                            if (!ResolveObjIndex(raw, chunk.texcoords.size(), corner.texcoord, relative)) {
+                                throw std::runtime_error(std::string{"invalid face in "}+file_name);
+                            }
+                            corner.flags |= obj_has_texcoord | (relative ? obj_texcoord_relative : 0);
+                        }
+                        if (value < line_end && *value == '/') {
+                            value = ParseObjIndex(value + 1, line_end, raw, found);
+                        }
+                    }
+
+                    if (value < line_end && !IsObjSpace(*value)) {
+                        throw std::runtime_error(std::string{"invalid face in "}+file_name);
+                    }
+                    face.push_back(corner);
+                }
+
+                for (size_t index = 2; index < face.size(); index++) {
+                    chunk.corners.push_back(face[0]);
+                    chunk.corners.push_back(face[index - 1]);
+                    chunk.corners.push_back(face[index]);
+                }
+            }
+
+            cursor = line_end + 1;
+        }
+    }
+
+    // Takes the high bits, leaving the low ones the welder probes with spread out within a shard.
+    uint32_t GetObjShard(uint32_t hash, uint32_t shard_count) {
+        return static_cast<uint32_t>((static_cast<uint64_t>(hash) * shard_count) >> 32);
+    }
+}
+
+// Chunks of the file are parsed in parallel, then their corners are deduplicated in parallel by
+// hashing each vertex to a shard. Vertices keep the order of their first use, as a serial pass over the
+// corners would give.
+void Utility::LoadModel(const char* file_name, std::vector<Vertex_Texture>& vertices, std::vector<uint32_t>& indices, JobSystem* job_system) {
+    PROFILE_FUNCTION();
+
+    MappedFile file{};
+    if (!MapFile(file_name, file)) {
+        throw std::runtime_error(std::string{"failed to open file "}+file_name);
+    }
+
+    const char* data = reinterpret_cast<const char*>(file.data);
+    uint32_t chunk_count = job_system == nullptr ? 1 : static_cast<uint32_t>(std::min<size_t>(std::max<size_t>(file.size / obj_chunk_size, 1), obj_max_chunks));
+    uint32_t shard_count = job_system == nullptr ? 1 : job_system->GetWorkerCount() * 2;
+
+    std::vector<ObjChunk> chunks(chunk_count);
+    const char* begin = data;
+    for (uint32_t index = 0; index < chunk_count; index++) {
+        const char* end = data + file.size;
+        if (index + 1 < chunk_count) {
+            end = std::max(begin, data + file.size / chunk_count * (index + 1));
+            const char* line_end = static_cast<const char*>(memchr(end, '\n', data + file.size - end));
+            end = line_end == nullptr ? data + file.size : line_end + 1;
+        }
+        chunks[index].begin = begin;
+        chunks[index].end = end;
+        begin = end;
+    }
 
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, file_name)) {
-        throw std::runtime_error(warn + err);
+    try {
+        ForEachIndex(job_system, chunk_count, [&](uint32_t index) {
+            ParseObjChunk(chunks[index], file_name);
+        });
+    } catch (...) {
+        UnmapFile(file);
+        throw;
+    }
+    UnmapFile(file);
+
+    size_t position_count = 0;
+    size_t texcoord_count = 0;
+    size_t corner_count = 0;
+    for (auto& chunk : chunks) {
+        chunk.position_base = position_count;
+        chunk.texcoord_base = texcoord_count;
+        chunk.corner_base = corner_count;
+        position_count += chunk.positions.size();
+        texcoord_count += chunk.texcoords.size();
+        corner_count += chunk.corners.size();
     }
 
-    std::unordered_map<Vertex_Texture, uint32_t, Vertex_Texture_Hash> unique_vertices = {};
+    if (corner_count > UINT32_MAX) {
+        throw std::runtime_error(std::string{"too many vertices in "}+file_name);
+    }
+
+    std::vector<glm::vec3> positions(position_count);
+    std::vector<glm::vec2> texcoords(texcoord_count);
+    ForEachIndex(job_system, chunk_count, [&](uint32_t index) {
+        ObjChunk& chunk = chunks[index];
+        std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.position_base);
+        std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), texcoords.begin() + chunk.texcoord_base);
+    });
+
+    VertexWelder<Vertex_Texture> hasher{};
+    std::vector<Vertex_Texture> corner_vertices(corner_count);
+    std::vector<uint32_t> corner_hashes(corner_count);
+    ForEachIndex(job_system, chunk_count, [&](uint32_t index) {
+        ObjChunk& chunk = chunks[index];
+        chunk.shard_corners.resize(shard_count);
+
+        for (size_t corner_index = 0; corner_index < chunk.corners.size(); corner_index++) {
+            ObjCorner& corner = chunk.corners[corner_index];
+
+            int64_t position = corner.position + ((corner.flags & obj_position_relative) ? static_cast<int64_t>(chunk.position_base) : 0);
+            int64_t texcoord = corner.texcoord + ((corner.flags & obj_texcoord_relative) ? static_cast<int64_t>(chunk.texcoord_base) : 0);
+            if (position < 0 || position >= static_cast<int64_t>(position_count) ||
+                ((corner.flags & obj_has_texcoord) && (texcoord < 0 || texcoord >= static_cast<int64_t>(texcoord_count)))) {
+                throw std::runtime_error(std::string{"invalid face index in "}+file_name);
+            }
 
-    for (const auto& shape : shapes) {
-        for (const auto& index : shape.mesh.indices) {
             Vertex_Texture vertex = {};
+            vertex.pos = positions[position];
+            if (corner.flags & obj_has_texcoord) {
+                vertex.texCoord = {texcoords[texcoord].x, 1.0f - texcoords[texcoord].y};
+            }
+
+            uint32_t global_index = static_cast<uint32_t>(chunk.corner_base + corner_index);
+            corner_vertices[global_index] = vertex;
+            corner_hashes[global_index] = hasher.Hash(vertex);
+            chunk.shard_corners[GetObjShard(corner_hashes[global_index], shard_count)].push_back(global_index);
+        }
+
+        chunk.corners = {};
+        chunk.positions = {};
+        chunk.texcoords = {};
+    });
 
-            vertex.pos = {
-                attrib.vertices[static_cast<size_t>(index.vertex_index) * 3 + 0],
-                attrib.vertices[static_cast<size_t>(index.vertex_index) * 3 + 1],
-                attrib.vertices[static_cast<size_t>(index.vertex_index) * 3 + 2]
-            };
+    // Each shard sees its corners in file order, so the first corner mapped for a vertex is its first use.
+    std::vector<uint32_t> first_use(corner_count);
+    ForEachIndex(job_system, shard_count, [&](uint32_t shard) {
+        PROFILE_SCOPE("DeduplicateObjShard");
 
-            vertex.texCoord = {
-                attrib.texcoords[static_cast<size_t>(index.texcoord_index) * 2 + 0],
-                1.0f - attrib.texcoords[static_cast<size_t>(index.texcoord_index) * 2 + 1]
-            };
+        size_t shard_size = 0;
+        for (auto& chunk : chunks) {
+            shard_size += chunk.shard_corners[shard].size();
+        }
 
-            if (unique_vertices.count(vertex) == 0) {
-                unique_vertices[vertex] = static_cast<uint32_t>(vertices.size());
-                vertices.push_back(vertex);
+        VertexWelder<Vertex_Texture> welder{0.0f, shard_size};
+        std::vector<uint32_t> first_corners{};
+        for (auto& chunk : chunks) {
+            for (uint32_t corner : chunk.shard_corners[shard]) {
+                uint32_t vertex = welder.Add(corner_vertices[corner], corner_hashes[corner]);
+                if (vertex == first_corners.size()) {
+                    first_corners.push_back(corner);
+                }
+                first_use[corner] = first_corners[vertex];
             }
+        }
+    });
+
+    ForEachIndex(job_system, chunk_count, [&](uint32_t index) {
+        ObjChunk& chunk = chunks[index];
+        chunk.shard_corners = {};
+        size_t corner_end = index + 1 < chunk_count ? chunks[index + 1].corner_base : corner_count;
+        for (size_t corner = chunk.corner_base; corner < corner_end; corner++) {
+            chunk.unique_count += first_use[corner] == corner;
+        }
+    });
+
+    uint32_t unique_count = 0;
+    for (auto& chunk : chunks) {
+        chunk.unique_base = unique_count;
+        unique_count += chunk.unique_count;
+    }
+
+    size_t vertex_base = vertices.size();
+    size_t index_base = indices.size();
+    vertices.resize(vertex_base + unique_count);
+    indices.resize(index_base + corner_count);
+
+    // The vertex number of each first use goes into indices first; the other corners read it there once
+    // every chunk has numbered its own.
+    ForEachIndex(job_system, chunk_count, [&](uint32_t index) {
+        ObjChunk& chunk = chunks[index];
+        size_t corner_end = index + 1 < chunk_count ? chunks[index + 1].corner_base : corner_count;
+        uint32_t vertex = static_cast<uint32_t>(vertex_base) + chunk.unique_base;
+        for (size_t corner = chunk.corner_base; corner < corner_end; corner++) {
+            if (first_use[corner] == corner) {
+                vertices[vertex] = corner_vertices[corner];
+                indices[index_base + corner] = vertex++;
+            }
+        }
+    });
+
+    ForEachIndex(job_system, chunk_count, [&](uint32_t index) {
+        ObjChunk& chunk = chunks[index];
+        size_t corner_end = index + 1 < chunk_count ? chunks[index + 1].corner_base : corner_count;
+        for (size_t corner = chunk.corner_base; corner < corner_end; corner++) {
+            if (first_use[corner] != corner) {
+                indices[index_base + corner] = indices[index_base + first_use[corner]];
+            }
+        }
+    });
+}
+
+namespace {
+    const char mesh_cache_magic[4] = {'V', 'T', 'M', 'C'};
+    // 2: meshes are stored after MeshOptimizer::Optimize.
+    // 3: levels of detail follow the full mesh in the index blob.
+    const uint32_t mesh_cache_version = 3;
+    const uint32_t mesh_cache_max_attributes = 8;
+    const uint32_t mesh_cache_max_lods = 8;
+
+    struct MeshCacheAttribute {
+        uint32_t location;
+        uint32_t format;
+        uint32_t offset;
+    };
+
+    // Fixed-size, little-endian, followed by the vertex and index blobs at the recorded offsets.
+    struct MeshCacheHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t source_size;
+        int64_t source_time;
+        uint32_t vertex_stride;
+        uint32_t attribute_count;
+        MeshCacheAttribute attributes[mesh_cache_max_attributes];
+        uint32_t index_size;
+        uint32_t vertex_count;
+        uint32_t index_count;
+        uint32_t padding;
+        uint64_t vertex_offset;
+        uint64_t index_offset;
+        float bounds_min[3];
+        float bounds_max[3];
+        uint32_t lod_count;
+        Utility::MeshLod lods[mesh_cache_max_lods];
+    };
+
+    const uint64_t mesh_cache_alignment = 16;
+
+    uint64_t AlignMeshCacheOffset(uint64_t offset) {
+        return (offset + mesh_cache_alignment - 1) & ~(mesh_cache_alignment - 1);
+    }
+
+    bool GetFileStamp(const char* file_name, uint64_t& size, int64_t& time) {
+#ifdef _WIN32
+        struct _stat64 status;
+        if (_stat64(file_name, &status) != 0) {
+            return false;
+        }
+#else
+        struct stat status;
+        if (stat(file_name, &status) != 0) {
+            return false;
+        }
+#endif
+        size = static_cast<uint64_t>(status.st_size);
+        time = static_cast<int64_t>(status.st_mtime);
+        return true;
+    }
+
+    // Describes Vertex_Texture as it is compiled now, so a cache written for another layout is rejected.
+    void FillMeshCacheLayout(MeshCacheHeader& header) {
+        std::vector<VkVertexInputAttributeDescription> attributes = Vertex_Texture::getAttributeDescriptions();
+        if (attributes.size() > mesh_cache_max_attributes) {
+            throw std::runtime_error("too many vertex attributes for the mesh cache");
+        }
+
+        header.vertex_stride = sizeof(Vertex_Texture);
+        header.attribute_count = static_cast<uint32_t>(attributes.size());
+        for (size_t index = 0; index < attributes.size(); index++) {
+            header.attributes[index] = {attributes[index].location, static_cast<uint32_t>(attributes[index].format), attributes[index].offset};
+        }
+        header.index_size = sizeof(uint32_t);
+    }
+}
+
+bool Utility::MapFile(const std::string& file_name, MappedFile& file) {
+    file = {};
+
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size) || size.QuadPart == 0) {
+        CloseHandle(handle);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(handle);
+    if (mapping == nullptr) {
+        return false;
+    }
+
+    // The view keeps the mapping alive after its handle is closed.
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (data == nullptr) {
+        return false;
+    }
+
+    file.data = static_cast<const unsigned char*>(data);
+    file.size = static_cast<size_t>(size.QuadPart);
+#else
+    int descriptor = open(file_name.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        return false;
+    }
+
+    struct stat status;
+    if (fstat(descriptor, &status) != 0 || status.st_size == 0) {
+        close(descriptor);
+        return false;
+    }
+
+    void* data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    madvise(data, static_cast<size_t>(status.st_size), MADV_WILLNEED);
+
+    file.data = static_cast<const unsigned char*>(data);
+    file.size = static_cast<size_t>(status.st_size);
+#endif
+
+    return true;
+}
+
+void Utility::UnmapFile(MappedFile& file) {
+    if (file.data == nullptr) {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(file.data);
+#else
+    munmap(const_cast<unsigned char*>(file.data), file.size);
+#endif
+
+    file = {};
+}
+
+bool Utility::LoadMeshCache(const char* file_name, MeshCache& mesh) {
+    PROFILE_FUNCTION();
+
+    mesh = {};
+
+    uint64_t source_size = 0;
+    int64_t source_time = 0;
+    if (!GetFileStamp(file_name, source_size, source_time)) {
+        return false;
+    }
+
+    if (!MapFile(std::string{file_name} + ".mesh", mesh.file)) {
+        return false;
+    }
 
-            indices.push_back(unique_vertices[vertex]);
+    MeshCacheHeader expected = {};
+    FillMeshCacheLayout(expected);
+
+    MeshCacheHeader header = {};
+    bool valid = mesh.file.size >= sizeof(header);
+    if (valid) {
+        memcpy(&header, mesh.file.data, sizeof(header));
+        valid = memcmp(header.magic, mesh_cache_magic, sizeof(header.magic)) == 0 &&
+            header.version == mesh_cache_version &&
+            header.source_size == source_size &&
+            header.source_time == source_time &&
+            header.vertex_stride == expected.vertex_stride &&
+            header.attribute_count == expected.attribute_count &&
+            memcmp(header.attributes, expected.attributes, sizeof(header.attributes)) == 0 &&
+            header.index_size == expected.index_size &&
+            header.vertex_offset % mesh_cache_alignment == 0 &&
+            header.index_offset % mesh_cache_alignment == 0 &&
+            header.vertex_offset + static_cast<uint64_t>(header.vertex_count) * header.vertex_stride <= mesh.file.size &&
+            header.index_offset + static_cast<uint64_t>(header.index_count) * header.index_size <= mesh.file.size &&
+            header.lod_count >= 1 && header.lod_count <= mesh_cache_max_lods;
+        for (uint32_t lod = 0; valid && lod < header.lod_count; lod++) {
+            valid = static_cast<uint64_t>(header.lods[lod].first_index) + header.lods[lod].index_count <= header.index_count;
         }
     }
+
+    if (!valid) {
+        UnmapFile(mesh.file);
+        return false;
+    }
+
+    mesh.vertices = reinterpret_cast<const Vertex_Texture*>(mesh.file.data + header.vertex_offset);
+    mesh.vertex_count = header.vertex_count;
+    mesh.indices = reinterpret_cast<const uint32_t*>(mesh.file.data + header.index_offset);
+    mesh.index_count = header.index_count;
+    mesh.bounds_min = {header.bounds_min[0], header.bounds_min[1], header.bounds_min[2]};
+    mesh.bounds_max = {header.bounds_max[0], header.bounds_max[1], header.bounds_max[2]};
+    mesh.lods.assign(header.lods, header.lods + header.lod_count);
+    return true;
+}
+
+void Utility::WriteMeshCache(const char* file_name, const std::vector<Vertex_Texture>& vertices, const std::vector<uint32_t>& indices, const std::vector<MeshLod>& lods) {
+    PROFILE_FUNCTION();
+
+    MeshCacheHeader header = {};
+    memcpy(header.magic, mesh_cache_magic, sizeof(header.magic));
+    header.version = mesh_cache_version;
+    if (!GetFileStamp(file_name, header.source_size, header.source_time)) {
+        throw std::runtime_error(std::string{"failed to open file "}+file_name);
+    }
+    FillMeshCacheLayout(header);
+    header.vertex_count = static_cast<uint32_t>(vertices.size());
+    header.index_count = static_cast<uint32_t>(indices.size());
+    header.vertex_offset = AlignMeshCacheOffset(sizeof(header));
+    header.index_offset = AlignMeshCacheOffset(header.vertex_offset + vertices.size() * sizeof(Vertex_Texture));
+
+    glm::vec3 bounds_min = vertices.empty() ? glm::vec3{0.0f} : vertices[0].pos;
+    glm::vec3 bounds_max = bounds_min;
+    for (auto& vertex : vertices) {
+        bounds_min = glm::min(bounds_min, vertex.pos);
+        bounds_max = glm::max(bounds_max, vertex.pos);
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        header.bounds_min[axis] = bounds_min[axis];
+        header.bounds_max[axis] = bounds_max[axis];
+    }
+
+    if (lods.size() > mesh_cache_max_lods) {
+        throw std::runtime_error("too many levels of detail for the mesh cache");
+    }
+    if (lods.empty()) {
+        header.lod_count = 1;
+        header.lods[0] = {0, header.index_count, 0.0f};
+    } else {
+        header.lod_count = static_cast<uint32_t>(lods.size());
+        std::copy(lods.begin(), lods.end(), header.lods);
+    }
+
+    // Written beside the cache and renamed over it, so a reader never maps a partly written file.
+    std::string cache_name = std::string{file_name} + ".mesh";
+    std::string temporary_name = cache_name + ".tmp";
+    {
+        std::ofstream file(temporary_name, std::ios::trunc | std::ios::binary);
+
+        if (!file.is_open()) {
+            throw std::runtime_error(std::string{"failed to open file "}+temporary_name);
+        }
+
+        const char padding[mesh_cache_alignment] = {};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(padding, header.vertex_offset - sizeof(header));
+        file.write(reinterpret_cast<const char*>(vertices.data()), vertices.size() * sizeof(Vertex_Texture));
+        file.write(padding, header.index_offset - header.vertex_offset - vertices.size() * sizeof(Vertex_Texture));
+        file.write(reinterpret_cast<const char*>(indices.data()), indices.size() * sizeof(uint32_t));
+
+        if (!file) {
+            throw std::runtime_error(std::string{"failed to write file "}+temporary_name);
+        }
+    }
+
+    std::remove(cache_name.c_str());
+    if (std::rename(temporary_name.c_str(), cache_name.c_str()) != 0) {
+        std::remove(temporary_name.c_str());
+        throw std::runtime_error(std::string{"failed to write file "}+cache_name);
+    }
+}
+
+void Utility::FreeMeshCache(MeshCache& mesh) {
+    UnmapFile(mesh.file);
+    mesh = {};
 }
 
 std::vector<unsigned char> Utility::ReadFile(const std::string& file_name) {
+    PROFILE_FUNCTION();
+
     std::ifstream file(file_name, std::ios::ate | std::ios::binary);
 
     if (!file.is_open()) {
@@ -81,7 +735,29 @@ std::vector<unsigned char> Utility::ReadFile(const std::string& file_name) {
     return buffer;
 }
 
+void Utility::WriteFile(const std::string& file_name, const std::vector<unsigned char>& data) {
+    std::ofstream file(file_name, std::ios::trunc | std::ios::binary);
+
+    if (!file.is_open()) {
+        throw std::runtime_error(std::string{"failed to open file "}+file_name);
+    }
+
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+    file.close();
+}
+
+void Utility::WritePng(const std::string& file_name, uint32_t width, uint32_t height, const unsigned char* rgba) {
+    PROFILE_FUNCTION();
+
+    if (!stbi_write_png(file_name.c_str(), width, height, 4, rgba, width * 4)) {
+        throw std::runtime_error(std::string{"failed to write image "}+file_name);
+    }
+}
+
 void Utility::LoadFontImage(const char* file_name, uint32_t font_size, FontImage& font_image, float& font_image_size, uint32_t& height, std::map<unsigned char, FontCharacter>& character_map) {
+    PROFILE_FUNCTION();
+
     FT_Library ft;
     if (FT_Init_FreeType(&ft)) {
         throw std::runtime_error("unable to initialize font library");
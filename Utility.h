@@ -1,10 +1,13 @@
 #pragma once
 
 #include <map>
+#include <string>
 #include <vector>
 
 #include "Geometry_Texture.h"
 
+class JobSystem;
+
 namespace Utility {
     struct Image {
         int texture_width;
@@ -36,7 +39,52 @@ namespace Utility {
 
     void FreeFontImage(FontImage& font);
 
-    void LoadModel(const char* file_name, std::vector<Vertex_Texture>& vertices, std::vector<uint32_t>& indices);
+    // Parses an OBJ file in parallel on job_system when given, or on the calling thread.
+    void LoadModel(const char* file_name, std::vector<Vertex_Texture>& vertices, std::vector<uint32_t>& indices, JobSystem* job_system = nullptr);
+
+    struct MappedFile {
+        const unsigned char* data;
+        size_t size;
+    };
+
+    // Maps file_name read-only. Returns false when the file cannot be opened or is empty.
+    bool MapFile(const std::string& file_name, MappedFile& file);
+
+    void UnmapFile(MappedFile& file);
+
+    // A range of a mesh's indices that draws it at one level of detail, and how far that may stray from
+    // the full mesh in model units.
+    struct MeshLod {
+        uint32_t first_index;
+        uint32_t index_count;
+        float error;
+    };
+
+    // A model's binary cache, kept next to it as <file_name>.mesh. vertices and indices point into the
+    // mapped file and stay valid until FreeMeshCache. lods runs from the full mesh to the coarsest one.
+    struct MeshCache {
+        MappedFile file;
+        const Vertex_Texture* vertices;
+        uint32_t vertex_count;
+        const uint32_t* indices;
+        uint32_t index_count;
+        glm::vec3 bounds_min;
+        glm::vec3 bounds_max;
+        std::vector<MeshLod> lods;
+    };
+
+    // Returns false when there is no cache, or it is from another version, another vertex layout or an
+    // older copy of the model.
+    bool LoadMeshCache(const char* file_name, MeshCache& mesh);
+
+    // Without lods the whole of indices is stored as the only level of detail.
+    void WriteMeshCache(const char* file_name, const std::vector<Vertex_Texture>& vertices, const std::vector<uint32_t>& indices, const std::vector<MeshLod>& lods = {});
+
+    void FreeMeshCache(MeshCache& mesh);
 
     std::vector<unsigned char> ReadFile(const std::string& file_name);
+
+    void WriteFile(const std::string& file_name, const std::vector<unsigned char>& data);
+
+    void WritePng(const std::string& file_name, uint32_t width, uint32_t height, const unsigned char* rgba);
 }
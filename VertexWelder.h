@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Deduplicates vertices through a flat open-addressing table. Vertex is compared and hashed as an array
+// of floats, so it must be made of floats only. With an epsilon, each float is snapped to the nearest
+// multiple of it before comparing, and vertices that snap together keep the first one's values.
+template <class Vertex>
+class VertexWelder {
+public:
+    static_assert(sizeof(Vertex) % sizeof(float) == 0, "vertices are welded as arrays of floats");
+
+    static const uint32_t no_vertex = UINT32_MAX;
+
+    explicit VertexWelder(float epsilon = 0.0f, size_t expected_count = 0) : epsilon_(epsilon), inverse_epsilon_(epsilon > 0.0f ? 1.0 / epsilon : 0.0) {
+        Reserve(expected_count);
+    }
+
+    // Sizes the table for count unique vertices so adding them never rehashes.
+    void Reserve(size_t count) {
+        vertices_.reserve(count);
+        hashes_.reserve(count);
+
+        size_t capacity = 16;
+        while (capacity < count * 2) {
+            capacity *= 2;
+        }
+        if (capacity > slots_.size()) {
+            Rehash(capacity);
+        }
+    }
+
+    uint32_t Hash(const Vertex& vertex) const {
+        uint32_t hash = 0x811c9dc5u;
+        const float* values = reinterpret_cast<const float*>(&vertex);
+        for (size_t index = 0; index < float_count_; index++) {
+            uint64_t key = Key(values[index]);
+            hash = (hash ^ static_cast<uint32_t>(key)) * 0x01000193u;
+            hash = (hash ^ static_cast<uint32_t>(key >> 32)) * 0x01000193u;
+        }
+
+        // Finalizer from MurmurHash3, so every bit of the key reaches the low bits used for probing.
+        hash ^= hash >> 16;
+        hash *= 0x85ebca6bu;
+        hash ^= hash >> 13;
+        hash *= 0xc2b2ae35u;
+        hash ^= hash >> 16;
+        return hash;
+    }
+
+    // Returns the index of the vertex, adding it when no equal vertex was added before.
+    uint32_t Add(const Vertex& vertex) {
+        return Add(vertex, Hash(vertex));
+    }
+
+    // hash must be Hash(vertex), for callers that already computed it.
+    uint32_t Add(const Vertex& vertex, uint32_t hash) {
+        if ((vertices_.size() + 1) * 2 > slots_.size()) {
+            Rehash(slots_.size() * 2);
+        }
+
+        size_t mask = slots_.size() - 1;
+        for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+            uint32_t index = slots_[slot];
+            if (index == no_vertex) {
+                index = static_cast<uint32_t>(vertices_.size());
+                slots_[slot] = index;
+                vertices_.push_back(vertex);
+                hashes_.push_back(hash);
+                return index;
+            }
+            if (hashes_[index] == hash && Equal(vertices_[index], vertex)) {
+                return index;
+            }
+        }
+    }
+
+    std::vector<Vertex>& GetVertices() {
+        return vertices_;
+    }
+
+    // Replaces vertices with the unique ones and rewrites indices to match.
+    static void Weld(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, float epsilon = 0.0f) {
+        VertexWelder welder{epsilon, vertices.size()};
+
+        std::vector<uint32_t> remap(vertices.size());
+        for (size_t index = 0; index < vertices.size(); index++) {
+            remap[index] = welder.Add(vertices[index]);
+        }
+        for (auto& index : indices) {
+            index = remap[index];
+        }
+
+        vertices.swap(welder.vertices_);
+    }
+
+private:
+    static const size_t float_count_ = sizeof(Vertex) / sizeof(float);
+
+    float epsilon_;
+    double inverse_epsilon_;
+    std::vector<uint32_t> slots_{};
+    std::vector<Vertex> vertices_{};
+    std::vector<uint32_t> hashes_{};
+
+    // Exact welding compares bit patterns, with -0 folded into 0.
+    uint64_t Key(float value) const {
+        if (epsilon_ > 0.0f) {
+            return static_cast<uint64_t>(static_cast<int64_t>(std::floor(static_cast<double>(value) * inverse_epsilon_ + 0.5)));
+        }
+
+        value += 0.0f;
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    bool Equal(const Vertex& a, const Vertex& b) const {
+        const float* a_values = reinterpret_cast<const float*>(&a);
+        const float* b_values = reinterpret_cast<const float*>(&b);
+        for (size_t index = 0; index < float_count_; index++) {
+            if (Key(a_values[index]) != Key(b_values[index])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void Rehash(size_t capacity) {
+        slots_.assign(capacity, no_vertex);
+
+        size_t mask = capacity - 1;
+        for (uint32_t index = 0; index < vertices_.size(); index++) {
+            size_t slot = hashes_[index] & mask;
+            while (slots_[slot] != no_vertex) {
+                slot = (slot + 1) & mask;
+            }
+            slots_[slot] = index;
+        }
+    }
+};
+
+template <class Vertex>
+const uint32_t VertexWelder<Vertex>::no_vertex;
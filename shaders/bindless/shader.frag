@@ -0,0 +1,19 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : enable
+
+layout(set = 1, binding = 0) uniform texture2D textures[];
+layout(set = 1, binding = 1) uniform sampler samplers[2];
+
+layout(push_constant) uniform PushConstants {
+    layout(offset = 8) uint textureIndex;
+    uint samplerIndex;
+} pushConstants;
+
+layout(location = 0) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = texture(sampler2D(textures[nonuniformEXT(pushConstants.textureIndex)], samplers[pushConstants.samplerIndex]), fragTexCoord);
+}
\ No newline at end of file
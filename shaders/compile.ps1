@@ -5,6 +5,11 @@
 # .frag - a fragment shader
 # .comp - a compute shader
 
+glslc bindless/shader.vert -o bindless/vert.spv
+glslc bindless/shader.frag -o bindless/frag.spv
+
+glslc bindless2d/shader.vert -o bindless2d/vert.spv
+
 glslc color/shader.vert -o color/vert.spv
 glslc color/shader.frag -o color/frag.spv
 
@@ -17,6 +22,9 @@ glslc notexture/shader.frag -o notexture/frag.spv
 glslc ortho2d/shader.vert -o ortho2d/vert.spv
 glslc ortho2d/shader.frag -o ortho2d/frag.spv
 
+glslc overlay/shader.vert -o overlay/vert.spv
+glslc overlay/shader.frag -o overlay/frag.spv
+
 glslc text/shader.vert -o text/vert.spv
 glslc text/shader.frag -o text/frag.spv
 